@@ -0,0 +1,115 @@
+#include "builtin.h"
+#include "config.h"
+#include "parse-options.h"
+#include "dir.h"
+
+static const char * const checkout_worker_usage[] = {
+	N_("git checkout--worker"),
+	NULL
+};
+
+/*
+ * Helper for parallel checkout (see parallel-checkout.c). Reads
+ * NUL-terminated "<mode> <oid> <path>" records from stdin and writes
+ * each blob verbatim to the given path. Entries that need content
+ * conversion are never sent here.
+ */
+static int write_one(char *record)
+{
+	char *end;
+	unsigned int mode;
+	struct object_id oid;
+	const char *path;
+	enum object_type type;
+	unsigned long size;
+	void *blob;
+	int fd;
+
+	mode = strtoul(record, &end, 8);
+	if (*end != ' ' || get_oid_hex(end + 1, &oid) ||
+	    end[1 + GIT_SHA1_HEXSZ] != ' ')
+		return error(_("malformed checkout record '%s'"), record);
+	path = end + 2 + GIT_SHA1_HEXSZ;
+	if (!*path)
+		return error(_("empty path in checkout record"));
+
+	blob = read_object_file(&oid, &type, &size);
+	if (!blob || type != OBJ_BLOB) {
+		free(blob);
+		return error(_("unable to read blob object %s"),
+			     oid_to_hex(&oid));
+	}
+
+	if (unlink(path) && errno != ENOENT) {
+		struct stat st;
+
+		/*
+		 * A directory may sit in the way (e.g. kept alive by an
+		 * untracked file); forced checkout replaces it, like the
+		 * sequential path does via remove_subtree().
+		 */
+		if (!lstat(path, &st) && S_ISDIR(st.st_mode)) {
+			struct strbuf dir = STRBUF_INIT;
+
+			strbuf_addstr(&dir, path);
+			if (remove_dir_recursively(&dir, 0)) {
+				strbuf_release(&dir);
+				free(blob);
+				return error_errno(_("cannot remove directory '%s'"),
+						   path);
+			}
+			strbuf_release(&dir);
+		} else {
+			free(blob);
+			return error_errno(_("cannot remove '%s'"), path);
+		}
+	}
+	if (safe_create_leading_directories_const(path)) {
+		free(blob);
+		return error(_("cannot create leading directories of '%s'"),
+			     path);
+	}
+
+	fd = open(path, O_WRONLY | O_CREAT | O_EXCL,
+		  (mode & 0100) ? 0777 : 0666);
+	if (fd < 0) {
+		free(blob);
+		return error_errno(_("unable to create file '%s'"), path);
+	}
+	if (write_in_full(fd, blob, size) < 0) {
+		close(fd);
+		free(blob);
+		return error_errno(_("unable to write file '%s'"), path);
+	}
+	free(blob);
+	if (close(fd))
+		return error_errno(_("unable to close file '%s'"), path);
+	return 0;
+}
+
+int cmd_checkout__worker(int argc, const char **argv, const char *prefix)
+{
+	struct strbuf record = STRBUF_INIT;
+	int errs = 0;
+	struct option checkout_worker_options[] = {
+		OPT_END()
+	};
+
+	argc = parse_options(argc, argv, prefix, checkout_worker_options,
+			     checkout_worker_usage, 0);
+	if (argc > 0)
+		usage_with_options(checkout_worker_usage,
+				   checkout_worker_options);
+
+	git_config(git_default_config, NULL);
+
+	while (strbuf_getwholeline(&record, stdin, '\0') != EOF) {
+		if (record.len && record.buf[record.len - 1] == '\0')
+			strbuf_setlen(&record, record.len - 1);
+		if (write_one(record.buf))
+			errs = 1;
+	}
+
+	strbuf_release(&record);
+	return errs;
+}
@@ -6,6 +6,7 @@
 #include "blob.h"
 #include "refs.h"
 #include "builtin.h"
+#include "prio-queue.h"
 #include "exec_cmd.h"
 #include "parse-options.h"
 #include "revision.h"
@@ -227,23 +228,22 @@ static int compare_pt(const void *a_, const void *b_)
 }
 
 static unsigned long finish_depth_computation(
-	struct commit_list **list,
+	struct prio_queue *queue,
 	struct possible_tag *best)
 {
 	unsigned long seen_commits = 0;
-	while (*list) {
-		struct commit *c = pop_commit(list);
+	while (queue->nr) {
+		struct commit *c = prio_queue_get(queue);
 		struct commit_list *parents = c->parents;
 		seen_commits++;
 		if (c->object.flags & best->flag_within) {
-			struct commit_list *a = *list;
-			while (a) {
-				struct commit *i = a->item;
-				if (!(i->object.flags & best->flag_within))
+			int i;
+			for (i = 0; i < queue->nr; i++) {
+				struct commit *pending = queue->array[i].data;
+				if (!(pending->object.flags & best->flag_within))
 					break;
-				a = a->next;
 			}
-			if (!a)
+			if (i == queue->nr)
 				break;
 		} else
 			best->depth++;
@@ -251,7 +251,7 @@ static unsigned long finish_depth_computation(
 			struct commit *p = parents->item;
 			parse_commit(p);
 			if (!(p->object.flags & SEEN))
-				commit_list_insert_by_date(p, list);
+				prio_queue_put(queue, p);
 			p->object.flags |= c->object.flags;
 			parents = parents->next;
 		}
@@ -291,7 +291,7 @@ static void append_suffix(int depth, const struct object_id *oid, struct strbuf
 static void describe_commit(struct object_id *oid, struct strbuf *dst)
 {
 	struct commit *cmit, *gave_up_on = NULL;
-	struct commit_list *list;
+	struct prio_queue queue = { compare_commits_by_commit_date };
 	struct commit_name *n;
 	struct possible_tag all_matches[MAX_TAGS];
 	unsigned int match_cnt = 0, annotated_cnt = 0, cur_match;
@@ -330,11 +330,10 @@ static void describe_commit(struct object_id *oid, struct strbuf *dst)
 		have_util = 1;
 	}
 
-	list = NULL;
 	cmit->object.flags = SEEN;
-	commit_list_insert(cmit, &list);
-	while (list) {
-		struct commit *c = pop_commit(&list);
+	prio_queue_put(&queue, cmit);
+	while (queue.nr) {
+		struct commit *c = prio_queue_get(&queue);
 		struct commit_list *parents = c->parents;
 		seen_commits++;
 		n = c->util;
@@ -361,7 +360,7 @@ static void describe_commit(struct object_id *oid, struct strbuf *dst)
 			if (!(c->object.flags & t->flag_within))
 				t->depth++;
 		}
-		if (annotated_cnt && !list) {
+		if (annotated_cnt && !queue.nr) {
 			if (debug)
 				fprintf(stderr, _("finished search at %s\n"),
 					oid_to_hex(&c->object.oid));
@@ -371,7 +370,7 @@ static void describe_commit(struct object_id *oid, struct strbuf *dst)
 			struct commit *p = parents->item;
 			parse_commit(p);
 			if (!(p->object.flags & SEEN))
-				commit_list_insert_by_date(p, &list);
+				prio_queue_put(&queue, p);
 			p->object.flags |= c->object.flags;
 			parents = parents->next;
 
@@ -401,11 +400,11 @@ static void describe_commit(struct object_id *oid, struct strbuf *dst)
 	QSORT(all_matches, match_cnt, compare_pt);
 
 	if (gave_up_on) {
-		commit_list_insert_by_date(gave_up_on, &list);
+		prio_queue_put(&queue, gave_up_on);
 		seen_commits--;
 	}
-	seen_commits += finish_depth_computation(&list, &all_matches[0]);
-	free_commit_list(list);
+	seen_commits += finish_depth_computation(&queue, &all_matches[0]);
+	clear_prio_queue(&queue);
 
 	if (debug) {
 		static int label_width = -1;
@@ -16,6 +16,7 @@
 #include "submodule-config.h"
 #include "submodule.h"
 #include "connected.h"
+#include "connect.h"
 #include "argv-array.h"
 #include "utf8.h"
 #include "packfile.h"
@@ -52,6 +53,7 @@ static const char *depth;
 static const char *deepen_since;
 static const char *upload_pack;
 static struct string_list deepen_not = STRING_LIST_INIT_NODUP;
+static struct string_list negotiation_tip = STRING_LIST_INIT_NODUP;
 static struct strbuf default_rla = STRBUF_INIT;
 static struct transport *gtransport;
 static struct transport *gsecondary;
@@ -75,6 +77,13 @@ static int git_fetch_config(const char *k, const char *v, void *cb)
 		return 0;
 	}
 
+	if (!strcmp(k, "fetch.negotiationtip")) {
+		if (!v)
+			return config_error_nonbool(k);
+		string_list_append(&negotiation_tip, xstrdup(v));
+		return 0;
+	}
+
 	if (!strcmp(k, "submodule.recurse")) {
 		int r = git_config_bool(k, v) ?
 			RECURSE_SUBMODULES_ON : RECURSE_SUBMODULES_OFF;
@@ -152,6 +161,8 @@ static struct option builtin_fetch_options[] = {
 		   N_("deepen history of shallow clone")),
 	OPT_STRING(0, "shallow-since", &deepen_since, N_("time"),
 		   N_("deepen history of shallow repository based on time")),
+	OPT_STRING_LIST(0, "negotiation-tip", &negotiation_tip, N_("revision"),
+			N_("report commits reachable from these tips only during negotiation")),
 	OPT_STRING_LIST(0, "shallow-exclude", &deepen_not, N_("revision"),
 			N_("deepen history of shallow clone, excluding rev")),
 	OPT_INTEGER(0, "deepen", &deepen_relative,
@@ -1055,6 +1066,9 @@ static struct transport *prepare_transport(struct remote *remote, int deepen)
 	if (deepen && deepen_not.nr)
 		set_option(transport, TRANS_OPT_DEEPEN_NOT,
 			   (const char *)&deepen_not);
+	if (negotiation_tip.nr)
+		set_option(transport, TRANS_OPT_NEGOTIATION_TIP,
+			   (const char *)&negotiation_tip);
 	if (deepen_relative)
 		set_option(transport, TRANS_OPT_DEEPEN_RELATIVE, "yes");
 	if (update_shallow)
@@ -1336,6 +1350,72 @@ static inline void fetch_one_setup_partial(struct remote *remote)
 	return;
 }
 
+/*
+ * If every refspec on the command line names a concrete ref (or a
+ * wildcard with a fixed prefix), tell the server so it can limit the
+ * advertisement to the matching refs. Tags are always requested since
+ * fetch may auto-follow them.
+ */
+static void advertise_ref_prefixes_from_refspecs(struct refspec *refspec,
+						 int ref_nr)
+{
+	int i;
+
+	if (!ref_nr)
+		return;
+
+	for (i = 0; i < ref_nr; i++) {
+		const char *src = refspec[i].src;
+
+		if (!src || !*src || refspec[i].exact_sha1)
+			return; /* cannot limit the advertisement */
+		if (refspec[i].pattern) {
+			const char *glob = strchr(src, '*');
+
+			if (!glob)
+				return;
+			continue;
+		}
+	}
+
+	for (i = 0; i < ref_nr; i++) {
+		const char *src = refspec[i].src;
+
+		if (refspec[i].pattern) {
+			char *prefix = xstrndup(src, strchr(src, '*') - src);
+
+			add_advertise_ref_prefix(prefix);
+			free(prefix);
+		} else if (starts_with(src, "refs/")) {
+			add_advertise_ref_prefix(src);
+		} else {
+			/*
+			 * A short name may resolve through any of the
+			 * ref_rev_parse_rules hierarchies on the remote;
+			 * ask for all of them, like refname_match() would
+			 * accept.
+			 */
+			static const char *fmts[] = {
+				"refs/%s",
+				"refs/heads/%s",
+				"refs/tags/%s",
+				"refs/remotes/%s",
+				"refs/remotes/%s/HEAD",
+			};
+			int j;
+
+			for (j = 0; j < ARRAY_SIZE(fmts); j++) {
+				char *full = xstrfmt(fmts[j], src);
+
+				add_advertise_ref_prefix(full);
+				free(full);
+			}
+			add_advertise_ref_prefix(src); /* e.g. HEAD */
+		}
+	}
+	add_advertise_ref_prefix("refs/tags/");
+}
+
 static int fetch_one(struct remote *remote, int argc, const char **argv, int prune_tags_ok)
 {
 	static const char **refs = NULL;
@@ -1403,6 +1483,7 @@ static int fetch_one(struct remote *remote, int argc, const char **argv, int pru
 	sigchain_push_common(unlock_pack_on_signal);
 	atexit(unlock_pack);
 	refspec = parse_fetch_refspec(ref_nr, refs);
+	advertise_ref_prefixes_from_refspecs(refspec, ref_nr);
 	exit_code = do_fetch(gtransport, refspec, ref_nr);
 	free_refspec(ref_nr, refspec);
 	transport_disconnect(gtransport);
@@ -17,6 +17,7 @@
 #include "streaming.h"
 #include "decorate.h"
 #include "packfile.h"
+#include "oidset.h"
 #include "object-store.h"
 
 #define REACHABLE 0x0001
@@ -125,6 +126,27 @@ static int fsck_error_func(struct fsck_options *o,
 
 static struct object_array pending;
 
+/*
+ * For --connectivity-only, every object in the store used to be
+ * materialized as a struct object just to carry the HAS_OBJ bit,
+ * which is where multi-gigabyte fsck RSS on blob-heavy stores came
+ * from. Keep the existence information in an oidset instead and only
+ * materialize what the reachability walk actually visits.
+ */
+static struct oidset connectivity_seen = OIDSET_INIT;
+
+static int object_is_known(struct object *obj)
+{
+	if (connectivity_only)
+		return oidset_contains(&connectivity_seen, &obj->oid);
+	return !!(obj->flags & HAS_OBJ);
+}
+
+static void mark_object_for_connectivity(const struct object_id *oid)
+{
+	oidset_insert(&connectivity_seen, oid);
+}
+
 static int mark_object(struct object *obj, int type, void *data, struct fsck_options *options)
 {
 	struct object *parent = data;
@@ -160,7 +182,7 @@ static int mark_object(struct object *obj, int type, void *data, struct fsck_opt
 		 */
 		return 0;
 
-	if (!(obj->flags & HAS_OBJ)) {
+	if (!object_is_known(obj)) {
 		if (parent && !has_object_file(&obj->oid)) {
 			printf("broken link from %7s %s\n",
 				 printable_type(parent), describe_object(parent));
@@ -224,7 +246,7 @@ static void check_reachable_object(struct object *obj)
 	 * except if it was in a pack-file and we didn't
 	 * do a full fsck
 	 */
-	if (!(obj->flags & HAS_OBJ)) {
+	if (!object_is_known(obj)) {
 		if (is_promisor_object(&obj->oid))
 			return;
 		if (has_sha1_pack(obj->oid.hash))
@@ -247,7 +269,7 @@ static void check_unreachable_object(struct object *obj)
 	 * to complain about it being unreachable (since it does
 	 * not exist).
 	 */
-	if (!(obj->flags & HAS_OBJ))
+	if (!object_is_known(obj))
 		return;
 
 	/*
@@ -326,6 +348,22 @@ static void check_connectivity(void)
 	/* Traverse the pending reachable objects */
 	traverse_reachable();
 
+	/*
+	 * With --connectivity-only, objects that the walk never reached
+	 * exist only in the oidset; materialize them now so the
+	 * unreachable/dangling reporting below still sees them.
+	 */
+	if (connectivity_only &&
+	    (show_unreachable || show_dangling || write_lost_and_found)) {
+		struct oidset_iter iter;
+		const struct object_id *oid;
+
+		oidset_iter_init(&connectivity_seen, &iter);
+		while ((oid = oidset_iter_next(&iter)))
+			if (!lookup_object(oid->hash))
+				lookup_unknown_object(oid->hash);
+	}
+
 	/* Look up all the requirements, warn about missing objects.. */
 	max = get_max_object_index();
 	if (verbose)
@@ -410,7 +448,10 @@ static void fsck_handle_reflog_oid(const char *refname, struct object_id *oid,
 
 	if (!is_null_oid(oid)) {
 		obj = lookup_object(oid->hash);
-		if (obj && (obj->flags & HAS_OBJ)) {
+		if (!obj && connectivity_only &&
+		    oidset_contains(&connectivity_seen, oid))
+			obj = lookup_unknown_object(oid->hash);
+		if (obj && object_is_known(obj)) {
 			if (timestamp && name_objects)
 				add_decoration(fsck_walk_options.object_names,
 					obj,
@@ -635,12 +676,6 @@ static int fsck_cache_tree(struct cache_tree *it)
 	return err;
 }
 
-static void mark_object_for_connectivity(const struct object_id *oid)
-{
-	struct object *obj = lookup_unknown_object(oid->hash);
-	obj->flags |= HAS_OBJ;
-}
-
 static int mark_loose_for_connectivity(const struct object_id *oid,
 				       const char *path,
 				       void *data)
@@ -763,7 +798,7 @@ int cmd_fsck(int argc, const char **argv, const char *prefix)
 		if (!get_oid(arg, &oid)) {
 			struct object *obj = lookup_object(oid.hash);
 
-			if (!obj || !(obj->flags & HAS_OBJ)) {
+			if (!obj || !object_is_known(obj)) {
 				if (is_promisor_object(&oid))
 					continue;
 				error("%s: object missing", oid_to_hex(&oid));
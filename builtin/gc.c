@@ -31,6 +31,8 @@ static const char * const builtin_gc_usage[] = {
 };
 
 static int pack_refs = 1;
+static int cruft_packs;
+static int maintenance_quiet;
 static int prune_reflogs = 1;
 static int aggressive_depth = 50;
 static int aggressive_window = 250;
@@ -124,6 +126,7 @@ static void gc_config(void)
 	git_config_get_int("gc.auto", &gc_auto_threshold);
 	git_config_get_int("gc.autopacklimit", &gc_auto_pack_limit);
 	git_config_get_bool("gc.autodetach", &detach_auto);
+	git_config_get_bool("gc.cruftpacks", &cruft_packs);
 	git_config_get_expiry("gc.pruneexpire", &prune_expire);
 	git_config_get_expiry("gc.worktreepruneexpire", &prune_worktrees_expire);
 	git_config_get_expiry("gc.logexpiry", &gc_log_expire);
@@ -190,6 +193,16 @@ static int too_many_packs(void)
 
 static void add_repack_all_option(void)
 {
+	if (cruft_packs) {
+		argv_array_push(&repack, "-a");
+		argv_array_push(&repack, "-d");
+		argv_array_push(&repack, "--cruft");
+		if (prune_expire)
+			argv_array_pushf(&repack, "--cruft-expiration=%s",
+					 prune_expire);
+		return;
+	}
+
 	if (prune_expire && !strcmp(prune_expire, "now"))
 		argv_array_push(&repack, "-a");
 	else {
@@ -493,3 +506,157 @@ int cmd_gc(int argc, const char **argv, const char *prefix)
 
 	return 0;
 }
+
+/*
+ * 'git maintenance run' executes the configured maintenance tasks in
+ * the foreground, so schedulers (cron, systemd timers) can keep
+ * repositories healthy without any user-facing command ever paying
+ * collection costs. Tasks share gc's repository lock.
+ */
+struct maintenance_task {
+	const char *name;
+	int (*fn)(void);
+	int enabled;
+};
+
+static int run_git_quietly(const char *arg1, const char *arg2, const char *arg3)
+{
+	struct child_process child = CHILD_PROCESS_INIT;
+
+	child.git_cmd = 1;
+	argv_array_push(&child.args, arg1);
+	if (arg2)
+		argv_array_push(&child.args, arg2);
+	if (arg3)
+		argv_array_push(&child.args, arg3);
+	return run_command(&child);
+}
+
+static int maintenance_task_prefetch(void)
+{
+	return run_git_quietly("fetch", "--all", "--quiet");
+}
+
+static int maintenance_task_loose_objects(void)
+{
+	/* roll loose objects into an incremental pack */
+	return run_git_quietly("repack", "-dq", NULL);
+}
+
+static int maintenance_task_incremental_repack(void)
+{
+	return run_git_quietly("repack", "-dq", "--geometric=2");
+}
+
+static int maintenance_task_gc(void)
+{
+	return run_git_quietly("gc", maintenance_quiet ? "--quiet" : NULL,
+			       NULL);
+}
+
+static struct maintenance_task maintenance_tasks[] = {
+	{ "prefetch", maintenance_task_prefetch, 0 },
+	{ "loose-objects", maintenance_task_loose_objects, 1 },
+	{ "incremental-repack", maintenance_task_incremental_repack, 1 },
+	{ "gc", maintenance_task_gc, 0 },
+};
+
+static int maintenance_run(void)
+{
+	int i, ret = 0;
+	pid_t pid;
+	const char *name;
+
+	/* never stack maintenance behind a running gc (or vice versa) */
+	name = lock_repo_for_gc(0, &pid);
+	if (name) {
+		warning(_("skipping maintenance; lock held by %s %"PRIuMAX),
+			name, (uintmax_t)pid);
+		return 0;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(maintenance_tasks); i++) {
+		if (!maintenance_tasks[i].enabled)
+			continue;
+		/*
+		 * The gc child takes the same gc.pid lease itself, so
+		 * drop ours just before running it; the earlier tasks
+		 * have finished by now.
+		 */
+		if (maintenance_tasks[i].fn == maintenance_task_gc &&
+		    is_tempfile_active(pidfile))
+			delete_tempfile(&pidfile);
+		if (maintenance_tasks[i].fn())
+			ret = error(_("task '%s' failed"),
+				    maintenance_tasks[i].name);
+	}
+	if (is_tempfile_active(pidfile))
+		delete_tempfile(&pidfile);
+	return ret;
+}
+
+static const char * const builtin_maintenance_usage[] = {
+	N_("git maintenance run [--task=<task>...]"),
+	NULL
+};
+
+static int task_option_parse(const struct option *opt, const char *arg,
+			     int unset)
+{
+	int i, found = 0;
+	static int seen_tasks;
+
+	if (unset || !arg)
+		return error(_("--task requires a value"));
+
+	if (!seen_tasks) {
+		/* an explicit list replaces the defaults */
+		for (i = 0; i < ARRAY_SIZE(maintenance_tasks); i++)
+			maintenance_tasks[i].enabled = 0;
+		seen_tasks = 1;
+	}
+	for (i = 0; i < ARRAY_SIZE(maintenance_tasks); i++) {
+		if (!strcmp(arg, maintenance_tasks[i].name)) {
+			maintenance_tasks[i].enabled = 1;
+			found = 1;
+		}
+	}
+	if (!found)
+		return error(_("'%s' is not a valid maintenance task"), arg);
+	return 0;
+}
+
+int cmd_maintenance(int argc, const char **argv, const char *prefix)
+{
+	int i;
+	struct option builtin_maintenance_options[] = {
+		OPT_CALLBACK(0, "task", NULL, N_("task"),
+			     N_("run a specific task"), task_option_parse),
+		OPT__QUIET(&maintenance_quiet, N_("suppress progress reporting")),
+		OPT_END()
+	};
+
+	git_config(git_default_config, NULL);
+	gc_config();
+
+	argc = parse_options(argc, argv, prefix,
+			     builtin_maintenance_options,
+			     builtin_maintenance_usage, 0);
+
+	for (i = 0; i < ARRAY_SIZE(maintenance_tasks); i++) {
+		struct strbuf key = STRBUF_INIT;
+		int enabled;
+
+		strbuf_addf(&key, "maintenance.%s.enabled",
+			    maintenance_tasks[i].name);
+		if (!git_config_get_bool(key.buf, &enabled))
+			maintenance_tasks[i].enabled = enabled;
+		strbuf_release(&key);
+	}
+
+	if (argc != 1 || strcmp(argv[0], "run"))
+		usage_with_options(builtin_maintenance_usage,
+				   builtin_maintenance_options);
+
+	return maintenance_run();
+}
@@ -1781,10 +1781,14 @@ int cmd_index_pack(int argc, const char **argv, const char *prefix)
 
 #ifndef NO_PTHREADS
 	if (!nr_threads) {
+		/*
+		 * The old default of capping at three threads dates back
+		 * to hardware where the zlib inflation did not scale;
+		 * on current machines delta resolution keeps all cores
+		 * busy, and pack.threads remains available to tune it
+		 * back down.
+		 */
 		nr_threads = online_cpus();
-		/* An experiment showed that more threads does not mean faster */
-		if (nr_threads > 3)
-			nr_threads = 3;
 	}
 #endif
 
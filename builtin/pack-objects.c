@@ -29,6 +29,7 @@
 #include "argv-array.h"
 #include "list.h"
 #include "packfile.h"
+#include "delta-islands.h"
 #include "object-store.h"
 
 static const char *pack_usage[] = {
@@ -65,6 +66,9 @@ static unsigned long pack_size_limit;
 static int depth = 50;
 static int delta_search_threads;
 static int pack_to_stdout;
+static int use_delta_islands;
+static int use_full_name_hash;
+static int thin;
 static int num_preferred_base;
 static struct progress *progress_state;
 
@@ -140,13 +144,22 @@ static void *get_delta(struct object_entry *entry)
 	return delta_buf;
 }
 
-static unsigned long do_compress(void **pptr, unsigned long size)
+/*
+ * Per-type compression policy: blobs are usually already-compressed
+ * or huge media in the repositories that care, while commits and
+ * trees recompress on every repack; let them be tuned apart.
+ * A negative value means "use pack.compression".
+ */
+static int pack_blob_compression_level = -1;
+
+static unsigned long do_compress_level(void **pptr, unsigned long size,
+				       int level)
 {
 	git_zstream stream;
 	void *in, *out;
 	unsigned long maxsize;
 
-	git_deflate_init(&stream, pack_compression_level);
+	git_deflate_init(&stream, level);
 	maxsize = git_deflate_bound(&stream, size);
 
 	in = *pptr;
@@ -165,6 +178,18 @@ static unsigned long do_compress(void **pptr, unsigned long size)
 	return stream.total_out;
 }
 
+static int type_compression_level(enum object_type type)
+{
+	if (type == OBJ_BLOB && pack_blob_compression_level >= 0)
+		return pack_blob_compression_level;
+	return pack_compression_level;
+}
+
+static unsigned long do_compress(void **pptr, unsigned long size)
+{
+	return do_compress_level(pptr, size, pack_compression_level);
+}
+
 static unsigned long write_large_blob_data(struct git_istream *st, struct hashfile *f,
 					   const struct object_id *oid)
 {
@@ -300,7 +325,8 @@ static unsigned long write_no_reuse_object(struct hashfile *f, struct object_ent
 	else if (entry->z_delta_size)
 		datalen = entry->z_delta_size;
 	else
-		datalen = do_compress(&buf, size);
+		datalen = do_compress_level(&buf, size,
+					    type_compression_level(type));
 
 	/*
 	 * The object header is a byte of 'type' followed by zero or
@@ -380,6 +406,8 @@ static off_t write_reuse_object(struct hashfile *f, struct object_entry *entry,
 	if (entry->delta)
 		type = (allow_ofs_delta && entry->delta->idx.offset) ?
 			OBJ_OFS_DELTA : OBJ_REF_DELTA;
+	else if (entry->ext_base_sha1)
+		type = OBJ_REF_DELTA;
 	hdrlen = encode_in_pack_object_header(header, sizeof(header),
 					      type, entry->size);
 
@@ -391,7 +419,9 @@ static off_t write_reuse_object(struct hashfile *f, struct object_entry *entry,
 		error("bad packed object CRC for %s",
 		      oid_to_hex(&entry->idx.oid));
 		unuse_pack(&w_curs);
-		return write_no_reuse_object(f, entry, limit, usable_delta);
+		return write_no_reuse_object(f, entry, limit,
+					     entry->ext_base_sha1 ?
+					     0 : usable_delta);
 	}
 
 	offset += entry->in_pack_header_size;
@@ -402,7 +432,9 @@ static off_t write_reuse_object(struct hashfile *f, struct object_entry *entry,
 		error("corrupt packed object for %s",
 		      oid_to_hex(&entry->idx.oid));
 		unuse_pack(&w_curs);
-		return write_no_reuse_object(f, entry, limit, usable_delta);
+		return write_no_reuse_object(f, entry, limit,
+					     entry->ext_base_sha1 ?
+					     0 : usable_delta);
 	}
 
 	if (type == OBJ_OFS_DELTA) {
@@ -425,7 +457,9 @@ static off_t write_reuse_object(struct hashfile *f, struct object_entry *entry,
 			return 0;
 		}
 		hashwrite(f, header, hdrlen);
-		hashwrite(f, entry->delta->idx.oid.hash, 20);
+		hashwrite(f, entry->ext_base_sha1 ?
+			  entry->ext_base_sha1 : entry->delta->idx.oid.hash,
+			  20);
 		hdrlen += 20;
 		reused_delta++;
 	} else {
@@ -465,7 +499,9 @@ static off_t write_object(struct hashfile *f,
 	else
 		limit = pack_size_limit - write_offset;
 
-	if (!entry->delta)
+	if (entry->ext_base_sha1)
+		usable_delta = 1;	/* peer already has the base */
+	else if (!entry->delta)
 		usable_delta = 0;	/* no delta */
 	else if (!pack_size_limit)
 	       usable_delta = 1;	/* unlimited packfile */
@@ -809,10 +845,12 @@ static void write_pack_file(void)
 		struct object_id oid;
 		char *pack_tmp_name = NULL;
 
-		if (pack_to_stdout)
+		if (pack_to_stdout) {
 			f = hashfd_throughput(1, "<stdout>", progress_state);
-		else
+		} else {
 			f = create_tmp_packfile(&pack_tmp_name);
+			hashfile_background_writeback(f);
+		}
 
 		offset = write_pack_header(f, nr_remaining);
 
@@ -837,9 +875,9 @@ static void write_pack_file(void)
 		 * If so, rewrite it like in fast-import
 		 */
 		if (pack_to_stdout) {
-			hashclose(f, oid.hash, CSUM_CLOSE);
+			hashclose(f, oid.hash, CSUM_HASH_IN_STREAM | CSUM_CLOSE);
 		} else if (nr_written == nr_remaining) {
-			hashclose(f, oid.hash, CSUM_FSYNC);
+			hashclose(f, oid.hash, CSUM_HASH_IN_STREAM | CSUM_FSYNC);
 		} else {
 			int fd = hashclose(f, oid.hash, 0);
 			fixup_pack_header_footer(fd, oid.hash, pack_tmp_name,
@@ -1103,7 +1141,9 @@ static int add_object_entry(const struct object_id *oid, enum object_type type,
 		return 0;
 	}
 
-	create_object_entry(oid, type, pack_name_hash(name),
+	create_object_entry(oid, type,
+			    use_full_name_hash ? pack_full_name_hash(name) :
+						 pack_name_hash(name),
 			    exclude, name && no_try_delta(name),
 			    index_pos, found_pack, found_offset);
 
@@ -1323,7 +1363,8 @@ static void add_preferred_base_object(const char *name)
 {
 	struct pbase_tree *it;
 	int cmplen;
-	unsigned hash = pack_name_hash(name);
+	unsigned hash = use_full_name_hash ? pack_full_name_hash(name) :
+					     pack_name_hash(name);
 
 	if (!num_preferred_base || check_pbase_path(hash))
 		return;
@@ -1491,6 +1532,19 @@ static void check_object(struct object_entry *entry)
 			base_entry->delta_child = entry;
 			unuse_pack(&w_curs);
 			return;
+		} else if (thin && base_ref &&
+			   bitmap_has_sha1_in_uninteresting(base_ref)) {
+			/*
+			 * The base is not going into the pack, but the
+			 * bitmap walk proved the peer has it, so a thin
+			 * pack may keep the on-disk delta verbatim and
+			 * just name the base.
+			 */
+			entry->type = entry->in_pack_type;
+			entry->delta_size = entry->size;
+			entry->ext_base_sha1 = xmemdupz(base_ref, 20);
+			unuse_pack(&w_curs);
+			return;
 		}
 
 		if (entry->type) {
@@ -1828,6 +1882,10 @@ static int try_delta(struct unpacked *trg, struct unpacked *src,
 	if (trg_entry->type != src_entry->type)
 		return -1;
 
+	if (use_delta_islands &&
+	    !in_same_island(&trg_entry->idx.oid, &src_entry->idx.oid))
+		return 0;
+
 	/*
 	 * We do not bother to try a delta that we discarded on an
 	 * earlier try, but only when reusing delta data.  Note that
@@ -2298,7 +2356,12 @@ static void ll_find_deltas(struct object_entry **list, unsigned list_size,
 		}
 
 		for (i = 0; i < delta_search_threads; i++)
-			if (p[i].remaining > 2*window &&
+			/*
+			 * Stealing pays off down to a single window's
+			 * worth of work; a coarser floor leaves the
+			 * other threads idle behind one long tail.
+			 */
+			if (p[i].remaining > window &&
 			    (!victim || victim->remaining < p[i].remaining))
 				victim = &p[i];
 		if (victim) {
@@ -2415,7 +2478,7 @@ static void prepare_pack(int window, int depth)
 	for (i = 0; i < to_pack.nr_objects; i++) {
 		struct object_entry *entry = to_pack.objects + i;
 
-		if (entry->delta)
+		if (entry->delta || entry->ext_base_sha1)
 			/* This happens if we decided to reuse existing
 			 * delta from a pack.  "reuse_delta &&" is implied.
 			 */
@@ -2487,6 +2550,19 @@ static int git_pack_config(const char *k, const char *v, void *cb)
 		else
 			write_bitmap_options &= ~BITMAP_OPT_HASH_CACHE;
 	}
+	if (!strcmp(k, "pack.blobcompression")) {
+		int level = git_config_int(k, v);
+		if (level == -1)
+			level = Z_DEFAULT_COMPRESSION;
+		else if (level < 0 || level > Z_BEST_COMPRESSION)
+			die(_("bad pack blob compression level %d"), level);
+		pack_blob_compression_level = level;
+		return 0;
+	}
+	if (!strcmp(k, "pack.usefullnamehash")) {
+		use_full_name_hash = git_config_bool(k, v);
+		return 0;
+	}
 	if (!strcmp(k, "pack.usebitmaps")) {
 		use_bitmap_index_default = git_config_bool(k, v);
 		return 0;
@@ -2949,7 +3025,6 @@ static int option_parse_unpack_unreachable(const struct option *opt,
 int cmd_pack_objects(int argc, const char **argv, const char *prefix)
 {
 	int use_internal_rev_list = 0;
-	int thin = 0;
 	int shallow = 0;
 	int all_progress_implied = 0;
 	struct argv_array rp = ARGV_ARRAY_INIT;
@@ -3008,6 +3083,10 @@ int cmd_pack_objects(int argc, const char **argv, const char *prefix)
 			 N_("output pack to stdout")),
 		OPT_BOOL(0, "include-tag", &include_tag,
 			 N_("include tag objects that refer to objects to be packed")),
+		OPT_BOOL(0, "delta-islands", &use_delta_islands,
+			 N_("respect islands during delta compression")),
+		OPT_BOOL(0, "full-name-hash", &use_full_name_hash,
+			 N_("use the full path for the delta sort name hash")),
 		OPT_BOOL(0, "keep-unreachable", &keep_unreachable,
 			 N_("keep unreachable objects")),
 		OPT_BOOL(0, "pack-loose-unreachable", &pack_loose_unreachable,
@@ -3171,6 +3250,11 @@ int cmd_pack_objects(int argc, const char **argv, const char *prefix)
 		}
 	}
 
+	if (use_delta_islands && !load_delta_islands()) {
+		warning(_("delta islands enabled, but no pack.island configured"));
+		use_delta_islands = 0;
+	}
+
 	if (progress)
 		progress_state = start_progress(_("Counting objects"), 0);
 	if (!use_internal_rev_list)
@@ -56,6 +56,7 @@ static off_t max_input_size;
 static int report_status;
 static int use_sideband;
 static int use_atomic;
+static int batch_ref_updates;
 static int use_push_options;
 static int quiet;
 static int prefer_ofs_delta = 1;
@@ -68,6 +69,8 @@ static const char *head_name;
 static void *head_name_to_free;
 static int sent_capabilities;
 static int shallow_update;
+static int pack_self_contained_and_connected;
+static int pack_connectivity_check = -1;
 static const char *alt_shallow_file;
 static struct strbuf push_cert = STRBUF_INIT;
 static struct object_id push_cert_oid;
@@ -216,6 +219,16 @@ static int receive_pack_config(const char *var, const char *value, void *cb)
 		return 0;
 	}
 
+	if (strcmp(var, "receive.packconnectivitycheck") == 0) {
+		pack_connectivity_check = git_config_bool(var, value);
+		return 0;
+	}
+
+	if (strcmp(var, "receive.batchrefupdates") == 0) {
+		batch_ref_updates = git_config_bool(var, value);
+		return 0;
+	}
+
 	if (strcmp(var, "receive.keepalive") == 0) {
 		keepalive_in_sec = git_config_int(var, value);
 		return 0;
@@ -1412,6 +1425,79 @@ static void execute_commands_non_atomic(struct command *commands,
 	strbuf_release(&err);
 }
 
+/*
+ * Like the atomic mode, run every update of this push through one ref
+ * transaction: one lock acquisition, one packed-refs rewrite and one
+ * reflog pass for the whole batch. Unlike --atomic, a failure must not
+ * reject the independent updates, so fall back to the one-by-one path
+ * when the batch cannot be committed.
+ */
+static void execute_commands_batched(struct command *commands,
+				     struct shallow_info *si)
+{
+	struct command *cmd;
+	struct strbuf err = STRBUF_INIT;
+
+	transaction = ref_transaction_begin(&err);
+	if (!transaction) {
+		rp_error("%s", err.buf);
+		strbuf_release(&err);
+		execute_commands_non_atomic(commands, si);
+		return;
+	}
+
+	for (cmd = commands; cmd; cmd = cmd->next) {
+		if (!should_process_cmd(cmd))
+			continue;
+
+		cmd->error_string = update(cmd, si);
+		if (cmd->error_string)
+			goto fallback;
+	}
+
+	if (ref_transaction_commit(transaction, &err)) {
+		rp_error("%s", err.buf);
+		goto fallback;
+	}
+	ref_transaction_free(transaction);
+	strbuf_release(&err);
+	return;
+
+fallback:
+	ref_transaction_free(transaction);
+
+	/*
+	 * Commit the updates that already passed their checks and
+	 * hooks one by one; re-running update() here would fire the
+	 * update hook a second time. Deletions of the current branch
+	 * and friends were all handled (or refused) by update()
+	 * above, so a plain transaction per ref is enough.
+	 */
+	for (cmd = commands; cmd; cmd = cmd->next) {
+		struct strbuf namespaced = STRBUF_INIT;
+
+		if (cmd->error_string || cmd->skip_update)
+			continue;
+
+		strbuf_addf(&namespaced, "%s%s", get_git_namespace(),
+			    cmd->ref_name);
+		strbuf_reset(&err);
+		transaction = ref_transaction_begin(&err);
+		if (!transaction ||
+		    ref_transaction_update(transaction, namespaced.buf,
+					   &cmd->new_oid, &cmd->old_oid,
+					   0, "push", &err) ||
+		    ref_transaction_commit(transaction, &err)) {
+			rp_error("%s", err.buf);
+			cmd->error_string = "failed to update ref";
+		}
+		ref_transaction_free(transaction);
+		strbuf_release(&namespaced);
+	}
+	transaction = NULL;
+	strbuf_release(&err);
+}
+
 static void execute_commands_atomic(struct command *commands,
 					struct shallow_info *si)
 {
@@ -1485,8 +1571,19 @@ static void execute_commands(struct command *commands,
 	opt.err_fd = err_fd;
 	opt.progress = err_fd && !quiet;
 	opt.env = tmp_objdir_env(tmp_objdir);
-	if (check_connected(iterate_receive_command_list, &data, &opt))
-		set_connectivity_errors(commands, si);
+	/*
+	 * When index-pack already proved that every link out of the
+	 * received pack resolves to a pack-internal or pre-existing
+	 * object, the full rev-list walk cannot find anything missing;
+	 * it only needs to run for the cases index-pack did not cover.
+	 */
+	if (shallow_update || !pack_self_contained_and_connected) {
+		if (check_connected(iterate_receive_command_list, &data, &opt))
+			set_connectivity_errors(commands, si);
+	} else if (opt.err_fd) {
+		/* check_connected() would have closed it for us */
+		close(opt.err_fd);
+	}
 
 	if (use_sideband)
 		finish_async(&muxer);
@@ -1521,6 +1618,8 @@ static void execute_commands(struct command *commands,
 
 	if (use_atomic)
 		execute_commands_atomic(commands, si);
+	else if (batch_ref_updates)
+		execute_commands_batched(commands, si);
 	else
 		execute_commands_non_atomic(commands, si);
 
@@ -1760,11 +1859,22 @@ static const char *unpack(int err_fd, struct shallow_info *si)
 			argv_array_push(&child.args, "--show-resolving-progress");
 		if (use_sideband)
 			argv_array_push(&child.args, "--report-end-of-input");
-		if (fsck_objects)
+		if (fsck_objects || pack_connectivity_check > 0)
 			argv_array_pushf(&child.args, "--strict%s",
 				fsck_msg_types.buf);
 		if (!reject_thin)
 			argv_array_push(&child.args, "--fix-thin");
+		/*
+		 * Only on explicit request: the index-pack proof is
+		 * one level deep and assumes every pre-existing object
+		 * has a complete closure, which repositories with
+		 * recent dangling objects whose ancestors were pruned
+		 * do not satisfy. Never weaken the full walk
+		 * implicitly.
+		 */
+		if (pack_connectivity_check > 0)
+			argv_array_push(&child.args,
+					"--check-self-contained-and-connected");
 		if (max_input_size)
 			argv_array_pushf(&child.args, "--max-input-size=%"PRIuMAX,
 				(uintmax_t)max_input_size);
@@ -1777,7 +1887,17 @@ static const char *unpack(int err_fd, struct shallow_info *si)
 		pack_lockfile = index_pack_lockfile(child.out);
 		close(child.out);
 		status = finish_command(&child);
-		if (status)
+		if (pack_connectivity_check > 0) {
+			/*
+			 * Exit code 1 just means some links point
+			 * outside the pack; index-pack has still
+			 * verified that every one of them resolves to
+			 * an object we already have.
+			 */
+			if (status && status != 1)
+				return "index-pack abnormal exit";
+			pack_self_contained_and_connected = 1;
+		} else if (status)
 			return "index-pack abnormal exit";
 		reprepare_packed_git(the_repository);
 	}
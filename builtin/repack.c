@@ -8,8 +8,11 @@
 #include "strbuf.h"
 #include "string-list.h"
 #include "argv-array.h"
+#include "packfile.h"
+#include "object-store.h"
 
 static int delta_base_offset = 1;
+static int use_delta_islands;
 static int pack_kept_objects = -1;
 static int write_bitmaps;
 static char *packdir, *packtmp;
@@ -31,6 +34,10 @@ static int repack_config(const char *var, const char *value, void *cb)
 		delta_base_offset = git_config_bool(var, value);
 		return 0;
 	}
+	if (!strcmp(var, "repack.usedeltaislands")) {
+		use_delta_islands = git_config_bool(var, value);
+		return 0;
+	}
 	if (!strcmp(var, "repack.packkeptobjects")) {
 		pack_kept_objects = git_config_bool(var, value);
 		return 0;
@@ -111,9 +118,305 @@ static void get_non_kept_pack_filenames(struct string_list *fname_list)
 	closedir(dir);
 }
 
+struct pack_geometry_entry {
+	char *name;	/* basename without ".pack" */
+	uint64_t count;	/* rough object count, derived from the idx size */
+};
+
+static int geometry_cmp(const void *va, const void *vb)
+{
+	const struct pack_geometry_entry *a = va, *b = vb;
+
+	if (a->count < b->count)
+		return -1;
+	if (a->count > b->count)
+		return 1;
+	return strcmp(a->name, b->name);
+}
+
+/*
+ * Pick the packs that break the geometric progression: after sorting
+ * by object count, each pack must hold at least 'factor' times as
+ * many objects as all smaller packs combined, or the smaller ones get
+ * rolled up into a new pack. Returns the number of packs to roll up;
+ * their names are appended to 'rollup'.
+ */
+static int select_geometric_packs(struct string_list *rollup, int factor)
+{
+	struct string_list all = STRING_LIST_INIT_NODUP;
+	struct pack_geometry_entry *geometry;
+	struct string_list_item *item;
+	uint64_t accum;
+	int i, nr, split;
+
+	get_non_kept_pack_filenames(&all);
+	nr = all.nr;
+	if (nr < 2) {
+		string_list_clear(&all, 0);
+		return 0;
+	}
+
+	ALLOC_ARRAY(geometry, nr);
+	i = 0;
+	for_each_string_list_item(item, &all) {
+		struct stat st;
+		uint64_t count = 0;
+
+		if (!stat(mkpath("%s/%s.idx", packdir, item->string), &st) &&
+		    st.st_size > 8 + 256 * 4 + 40)
+			count = (st.st_size - 8 - 256 * 4 - 40) / 28;
+		geometry[i].name = item->string;
+		geometry[i].count = count;
+		i++;
+	}
+	QSORT(geometry, nr, geometry_cmp);
+
+	split = 0;
+	accum = 0;
+	for (i = 0; i < nr; i++) {
+		if (i && geometry[i].count < (uint64_t)factor * accum)
+			split = i + 1;
+		accum += geometry[i].count;
+	}
+
+	if (split < 2)
+		split = 0;
+	for (i = 0; i < split; i++)
+		string_list_append(rollup, geometry[i].name);
+
+	free(geometry);
+	string_list_clear(&all, 0);
+	return split;
+}
+
+
+/*
+ * Cruft packs: instead of exploding unreachable-but-recent objects
+ * into loose files, collect everything from the old packs that did
+ * not make it into the new pack into one dedicated pack, with a
+ * "pack-*.cruft" sidecar recording one "<epoch> <oid>" line per
+ * object. Objects keep their recorded mtime across cruft repacks and
+ * are dropped once it falls past the expiration.
+ */
+static void read_cruft_table(const char *idx, struct string_list *mtimes)
+{
+	struct strbuf path = STRBUF_INIT;
+	struct strbuf line = STRBUF_INIT;
+	FILE *fp;
+	size_t len;
+
+	strbuf_addstr(&path, idx);
+	if (strip_suffix(path.buf, ".idx", &len))
+		strbuf_setlen(&path, len);
+	strbuf_addstr(&path, ".cruft");
+
+	fp = fopen(path.buf, "r");
+	if (fp) {
+		while (strbuf_getline_lf(&line, fp) != EOF) {
+			const char *sp = strchr(line.buf, ' ');
+
+			if (sp)
+				string_list_append(mtimes, sp + 1)->util =
+					(void *)(intptr_t)strtoumax(line.buf,
+								    NULL, 10);
+		}
+		fclose(fp);
+	}
+	strbuf_release(&path);
+	strbuf_release(&line);
+}
+
+struct new_pack_set {
+	struct packed_git **packs;
+	int nr;
+};
+
+static int in_new_packs(const struct object_id *oid,
+			const struct new_pack_set *new_packs)
+{
+	int i;
+
+	for (i = 0; i < new_packs->nr; i++)
+		if (find_pack_entry_one(oid->hash, new_packs->packs[i]))
+			return 1;
+	return 0;
+}
+
+struct cruft_loose_data {
+	FILE *in;
+	struct new_pack_set *new_packs;
+	struct string_list *cruft_lines;
+	timestamp_t expire;
+	int *packed_anything;
+};
+
+static int add_loose_to_cruft(const struct object_id *oid, const char *path,
+			      void *data)
+{
+	struct cruft_loose_data *cb = data;
+	struct stat st;
+	timestamp_t mtime;
+	struct strbuf line = STRBUF_INIT;
+
+	if (in_new_packs(oid, cb->new_packs))
+		return 0;
+	if (stat(path, &st))
+		mtime = time(NULL); /* never expire on a failed stat */
+	else
+		mtime = st.st_mtime;
+	if (cb->expire && mtime < cb->expire)
+		return 0;
+
+	fprintf(cb->in, "%s\n", oid_to_hex(oid));
+	strbuf_addf(&line, "%"PRItime" %s", mtime, oid_to_hex(oid));
+	string_list_append(cb->cruft_lines, line.buf);
+	strbuf_release(&line);
+	*cb->packed_anything = 1;
+	return 0;
+}
+
+static int write_cruft_pack(struct string_list *rolled_packs,
+			    const struct string_list *new_pack_names,
+			    timestamp_t expire,
+			    struct string_list *out_names)
+{
+	struct child_process cmd = CHILD_PROCESS_INIT;
+	struct string_list mtimes = STRING_LIST_INIT_DUP;
+	struct string_list cruft_lines = STRING_LIST_INIT_DUP;
+	struct string_list_item *item;
+	struct new_pack_set new_packs = { NULL, 0 };
+	struct strbuf line = STRBUF_INIT;
+	FILE *in;
+	int i, ret, packed_anything = 0;
+
+	/*
+	 * With pack.packSizeLimit in effect the reachable objects may
+	 * have been split over several new packs; an object in any of
+	 * them is not cruft.
+	 */
+	ALLOC_ARRAY(new_packs.packs, new_pack_names->nr);
+	for_each_string_list_item(item, new_pack_names) {
+		char *new_idx = mkpathdup("%s-%s.idx", packtmp, item->string);
+		struct packed_git *p = add_packed_git(new_idx,
+						      strlen(new_idx), 1);
+
+		if (!p || open_pack_index(p))
+			die(_("could not open just-written pack '%s'"),
+			    new_idx);
+		new_packs.packs[new_packs.nr++] = p;
+		free(new_idx);
+	}
+
+	for_each_string_list_item(item, rolled_packs) {
+		char *idx = mkpathdup("%s/%s.idx", packdir, item->string);
+
+		read_cruft_table(idx, &mtimes);
+		free(idx);
+	}
+	string_list_sort(&mtimes);
+
+	argv_array_pushl(&cmd.args, "pack-objects", "--non-empty", NULL);
+	if (delta_base_offset)
+		argv_array_push(&cmd.args, "--delta-base-offset");
+	argv_array_push(&cmd.args, packtmp);
+	cmd.git_cmd = 1;
+	cmd.in = -1;
+	cmd.out = -1;
+	if (start_command(&cmd))
+		die(_("could not start pack-objects for the cruft pack"));
+
+	in = xfdopen(cmd.in, "w");
+	for_each_string_list_item(item, rolled_packs) {
+		char *idx = mkpathdup("%s/%s.idx", packdir, item->string);
+		struct packed_git *p = add_packed_git(idx, strlen(idx), 1);
+		struct stat st;
+		timestamp_t pack_mtime = 0;
+		uint32_t n;
+
+		if (!p || open_pack_index(p))
+			die(_("could not open pack index '%s'"), idx);
+		if (stat(p->pack_name, &st))
+			pack_mtime = time(NULL); /* never expire on a failed stat */
+		else
+			pack_mtime = st.st_mtime;
+
+		for (n = 0; n < p->num_objects; n++) {
+			struct object_id oid;
+			struct string_list_item *known;
+			timestamp_t mtime = pack_mtime;
+
+			nth_packed_object_oid(&oid, p, n);
+			if (in_new_packs(&oid, &new_packs))
+				continue; /* made it into a new pack */
+
+			known = string_list_lookup(&mtimes, oid_to_hex(&oid));
+			if (known)
+				mtime = (timestamp_t)(intptr_t)known->util;
+			if (expire && mtime < expire)
+				continue; /* cruft old enough to drop */
+
+			fprintf(in, "%s\n", oid_to_hex(&oid));
+			strbuf_reset(&line);
+			strbuf_addf(&line, "%"PRItime" %s", mtime,
+				    oid_to_hex(&oid));
+			string_list_append(&cruft_lines, line.buf);
+			packed_anything = 1;
+		}
+		close_pack(p);
+		free(p);
+		free(idx);
+	}
+
+	{
+		struct cruft_loose_data cb;
+
+		cb.in = in;
+		cb.new_packs = &new_packs;
+		cb.cruft_lines = &cruft_lines;
+		cb.expire = expire;
+		cb.packed_anything = &packed_anything;
+		for_each_loose_object(add_loose_to_cruft, &cb, 0);
+	}
+	fclose(in);
+
+	ret = 0;
+	{
+	FILE *out = xfdopen(cmd.out, "r");
+	while (strbuf_getline_lf(&line, out) != EOF) {
+		if (line.len != 40)
+			die(_("repack: expected 40-character pack name from pack-objects"));
+		string_list_append(out_names, line.buf);
+		if (packed_anything) {
+			struct strbuf path = STRBUF_INIT;
+			FILE *table;
+
+			strbuf_addf(&path, "%s-%s.cruft", packtmp, line.buf);
+			table = xfopen(path.buf, "w");
+			for_each_string_list_item(item, &cruft_lines)
+				fprintf(table, "%s\n", item->string);
+			fclose(table);
+			strbuf_release(&path);
+		}
+	}
+	fclose(out);
+	}
+	if (finish_command(&cmd))
+		ret = error(_("pack-objects for the cruft pack failed"));
+
+	for (i = 0; i < new_packs.nr; i++) {
+		close_pack(new_packs.packs[i]);
+		free(new_packs.packs[i]);
+	}
+	free(new_packs.packs);
+	string_list_clear(&mtimes, 0);
+	string_list_clear(&cruft_lines, 0);
+	strbuf_release(&line);
+	return ret;
+}
+
 static void remove_redundant_pack(const char *dir_name, const char *base_name)
 {
-	const char *exts[] = {".pack", ".idx", ".keep", ".bitmap"};
+	const char *exts[] = {".pack", ".idx", ".keep", ".bitmap", ".cruft"};
 	int i;
 	struct strbuf buf = STRBUF_INIT;
 	size_t plen;
@@ -141,6 +444,7 @@ int cmd_repack(int argc, const char **argv, const char *prefix)
 		{".pack"},
 		{".idx"},
 		{".bitmap", 1},
+		{".cruft", 1},
 	};
 	struct child_process cmd = CHILD_PROCESS_INIT;
 	struct string_list_item *item;
@@ -156,6 +460,8 @@ int cmd_repack(int argc, const char **argv, const char *prefix)
 	int delete_redundant = 0;
 	const char *unpack_unreachable = NULL;
 	int keep_unreachable = 0;
+	int cruft = 0;
+	const char *cruft_expiration = NULL;
 	const char *window = NULL, *window_memory = NULL;
 	const char *depth = NULL;
 	const char *threads = NULL;
@@ -164,6 +470,7 @@ int cmd_repack(int argc, const char **argv, const char *prefix)
 	int no_update_server_info = 0;
 	int quiet = 0;
 	int local = 0;
+	int geometric_factor = 0;
 
 	struct option builtin_repack_options[] = {
 		OPT_BIT('a', NULL, &pack_everything,
@@ -200,6 +507,12 @@ int cmd_repack(int argc, const char **argv, const char *prefix)
 				N_("maximum size of each packfile")),
 		OPT_BOOL(0, "pack-kept-objects", &pack_kept_objects,
 				N_("repack objects in packs marked with .keep")),
+		OPT_INTEGER('g', "geometric", &geometric_factor,
+				N_("find a geometric progression with factor <N>")),
+		OPT_BOOL(0, "cruft", &cruft,
+				N_("with -a, pack unreachable objects separately")),
+		OPT_STRING(0, "cruft-expiration", &cruft_expiration, N_("approxidate"),
+				N_("with --cruft, expire cruft objects older than this")),
 		OPT_END()
 	};
 
@@ -221,12 +534,32 @@ int cmd_repack(int argc, const char **argv, const char *prefix)
 	if (write_bitmaps && !(pack_everything & ALL_INTO_ONE))
 		die(_(incremental_bitmap_conflict_error));
 
+	if (geometric_factor && pack_everything)
+		die(_("--geometric is incompatible with -a/-A"));
+	if (cruft) {
+		if (!(pack_everything & ALL_INTO_ONE) || !delete_redundant)
+			die(_("--cruft requires -a -d"));
+		if (unpack_unreachable || keep_unreachable ||
+		    (pack_everything & LOOSEN_UNREACHABLE))
+			die(_("--cruft is incompatible with -A, "
+			      "--keep-unreachable and --unpack-unreachable"));
+	}
+
 	packdir = mkpathdup("%s/pack", get_object_directory());
 	packtmp = mkpathdup("%s/.tmp-%d-pack", packdir, (int)getpid());
 
 	sigchain_push_common(remove_pack_on_signal);
 
 	argv_array_push(&cmd.args, "pack-objects");
+	if (geometric_factor) {
+		if (!select_geometric_packs(&existing_packs,
+					    geometric_factor)) {
+			if (!quiet)
+				printf("Nothing to roll up.\n");
+			return 0;
+		}
+		argv_array_push(&cmd.args, "--non-empty");
+	} else {
 	argv_array_push(&cmd.args, "--keep-true-parents");
 	if (!pack_kept_objects)
 		argv_array_push(&cmd.args, "--honor-pack-keep");
@@ -236,6 +569,7 @@ int cmd_repack(int argc, const char **argv, const char *prefix)
 	argv_array_push(&cmd.args, "--indexed-objects");
 	if (repository_format_partial_clone)
 		argv_array_push(&cmd.args, "--exclude-promisor-objects");
+	}
 	if (window)
 		argv_array_pushf(&cmd.args, "--window=%s", window);
 	if (window_memory)
@@ -253,11 +587,17 @@ int cmd_repack(int argc, const char **argv, const char *prefix)
 	if (write_bitmaps)
 		argv_array_push(&cmd.args, "--write-bitmap-index");
 
-	if (pack_everything & ALL_INTO_ONE) {
+	if (geometric_factor)
+		; /* object list is fed on stdin below */
+	else if (pack_everything & ALL_INTO_ONE) {
 		get_non_kept_pack_filenames(&existing_packs);
 
 		if (existing_packs.nr && delete_redundant) {
-			if (unpack_unreachable) {
+			if (cruft) {
+				/* unreachable objects go to the cruft pack */
+				argv_array_push(&cmd.env_array,
+						"GIT_REF_PARANOIA=1");
+			} else if (unpack_unreachable) {
 				argv_array_pushf(&cmd.args,
 						"--unpack-unreachable=%s",
 						unpack_unreachable);
@@ -283,17 +623,52 @@ int cmd_repack(int argc, const char **argv, const char *prefix)
 		argv_array_push(&cmd.args,  "--quiet");
 	if (delta_base_offset)
 		argv_array_push(&cmd.args,  "--delta-base-offset");
+	if (use_delta_islands)
+		argv_array_push(&cmd.args,  "--delta-islands");
 
 	argv_array_push(&cmd.args, packtmp);
 
 	cmd.git_cmd = 1;
 	cmd.out = -1;
-	cmd.no_stdin = 1;
+	if (geometric_factor)
+		cmd.in = -1;
+	else
+		cmd.no_stdin = 1;
 
 	ret = start_command(&cmd);
 	if (ret)
 		return ret;
 
+	if (geometric_factor) {
+		/*
+		 * Feed every object contained in the rolled-up packs;
+		 * pack-objects reuses their deltas wherever the base
+		 * lands in the same new pack.
+		 */
+		FILE *in = xfdopen(cmd.in, "w");
+
+		for_each_string_list_item(item, &existing_packs) {
+			char *idx = mkpathdup("%s/%s.idx", packdir,
+					      item->string);
+			struct packed_git *p = add_packed_git(idx,
+							      strlen(idx), 1);
+			uint32_t n;
+
+			if (!p || open_pack_index(p))
+				die(_("could not open pack index '%s'"), idx);
+			for (n = 0; n < p->num_objects; n++) {
+				struct object_id oid;
+
+				nth_packed_object_oid(&oid, p, n);
+				fprintf(in, "%s\n", oid_to_hex(&oid));
+			}
+			close_pack(p);
+			free(p);
+			free(idx);
+		}
+		fclose(in);
+	}
+
 	out = xfdopen(cmd.out, "r");
 	while (strbuf_getline_lf(&line, out) != EOF) {
 		if (line.len != 40)
@@ -308,6 +683,16 @@ int cmd_repack(int argc, const char **argv, const char *prefix)
 	if (!names.nr && !quiet)
 		printf("Nothing new to pack.\n");
 
+	if (cruft && names.nr && existing_packs.nr) {
+		timestamp_t expire = 0;
+
+		if (cruft_expiration && *cruft_expiration &&
+		    strcmp(cruft_expiration, "never"))
+			expire = approxidate(cruft_expiration);
+		if (write_cruft_pack(&existing_packs, &names, expire, &names))
+			return 1;
+	}
+
 	/*
 	 * Ok we have prepared all new packfiles.
 	 * First see if there are packs of the same name and if so
@@ -440,6 +440,16 @@ int cmd_rev_list(int argc, const char **argv, const char *prefix)
 			use_bitmap_index = 1;
 			continue;
 		}
+		if (!strcmp(arg, "--unordered")) {
+			/*
+			 * The caller does not care about output order, so
+			 * any enumeration shortcut (currently: the bitmap
+			 * walk) may be used even though it changes the
+			 * order and omits object names.
+			 */
+			use_bitmap_index = 1;
+			continue;
+		}
 		if (!strcmp(arg, "--test-bitmap")) {
 			test_bitmap_walk(&revs);
 			return 0;
@@ -36,7 +36,7 @@ static void finish_bulk_checkin(struct bulk_checkin_state *state)
 		unlink(state->pack_tmp_name);
 		goto clear_exit;
 	} else if (state->nr_written == 1) {
-		hashclose(state->f, oid.hash, CSUM_FSYNC);
+		hashclose(state->f, oid.hash, CSUM_HASH_IN_STREAM | CSUM_FSYNC);
 	} else {
 		int fd = hashclose(state->f, oid.hash, 0);
 		fixup_pack_header_footer(fd, oid.hash, state->pack_tmp_name,
@@ -267,6 +267,11 @@ int index_bulk_checkin(struct object_id *oid,
 	return status;
 }
 
+int bulk_checkin_plugged(void)
+{
+	return state.plugged;
+}
+
 void plug_bulk_checkin(void)
 {
 	state.plugged = 1;
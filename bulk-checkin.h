@@ -8,6 +8,7 @@ extern int index_bulk_checkin(struct object_id *oid,
 			      int fd, size_t size, enum object_type type,
 			      const char *path, unsigned flags);
 
+extern int bulk_checkin_plugged(void);
 extern void plug_bulk_checkin(void);
 extern void unplug_bulk_checkin(void);
 
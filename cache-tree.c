@@ -575,7 +575,7 @@ struct cache_tree *cache_tree_read(const char *buffer, unsigned long size)
 	return read_one(&buffer, &size);
 }
 
-static struct cache_tree *cache_tree_find(struct cache_tree *it, const char *path)
+struct cache_tree *cache_tree_find(struct cache_tree *it, const char *path)
 {
 	if (!it)
 		return NULL;
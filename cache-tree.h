@@ -23,6 +23,7 @@ struct cache_tree {
 };
 
 struct cache_tree *cache_tree(void);
+struct cache_tree *cache_tree_find(struct cache_tree *it, const char *path);
 void cache_tree_free(struct cache_tree **);
 void cache_tree_invalidate_path(struct index_state *, const char *);
 struct cache_tree_sub *cache_tree_sub(struct cache_tree *, const char *);
@@ -192,6 +192,13 @@ struct cache_entry {
 /* used to temporarily mark paths matched by pathspecs */
 #define CE_MATCHED           (1 << 26)
 
+/*
+ * A sparse directory entry stands in for an entire directory that
+ * lies outside the sparse-checkout definition; its name ends with a
+ * slash and its oid names a tree object.
+ */
+#define S_ISSPARSEDIR(ce) ((ce)->ce_mode == S_IFDIR)
+
 #define CE_UPDATE_IN_BASE    (1 << 27)
 #define CE_STRIP_NAME        (1 << 28)
 
@@ -321,7 +328,8 @@ struct index_state {
 	struct cache_time timestamp;
 	unsigned name_hash_initialized : 1,
 		 initialized : 1,
-		 drop_cache_tree : 1;
+		 drop_cache_tree : 1,
+		 sparse_index : 1;
 	struct hashmap name_hash;
 	struct hashmap dir_hash;
 	unsigned char sha1[20];
@@ -590,6 +598,15 @@ extern int daemonize(void);
 struct lock_file;
 extern int read_index(struct index_state *);
 extern int read_index_preload(struct index_state *, const struct pathspec *pathspec);
+
+/*
+ * Parallel stat phase: prime the stat cache of the index entries
+ * matching the pathspec, marking entries that match their on-disk
+ * state CE_UPTODATE so that subsequent refresh/diff passes can skip
+ * the lstat entirely.
+ */
+extern void preload_index(struct index_state *index,
+			  const struct pathspec *pathspec);
 extern int do_read_index(struct index_state *istate, const char *path,
 			 int must_exist); /* for testting only! */
 extern int read_index_from(struct index_state *, const char *path,
@@ -780,6 +797,7 @@ extern size_t packed_git_window_size;
 extern size_t packed_git_limit;
 extern size_t delta_base_cache_limit;
 extern unsigned long big_file_threshold;
+extern unsigned long bulk_checkin_threshold;
 extern unsigned long pack_size_limit_cfg;
 
 /*
@@ -805,6 +823,8 @@ extern char *git_replace_ref_base;
 
 extern int fsync_object_files;
 extern int core_preload_index;
+extern int core_commit_graph;
+extern int core_multi_pack_index;
 extern int core_apply_sparse_checkout;
 extern int precomposed_unicode;
 extern int protect_hfs;
@@ -896,12 +916,14 @@ extern int grafts_replace_parents;
 #define GIT_REPO_VERSION_READ 1
 extern int repository_format_precious_objects;
 extern char *repository_format_partial_clone;
+extern char *repository_format_ref_storage;
 extern const char *core_partial_clone_filter_default;
 
 struct repository_format {
 	int version;
 	int precious_objects;
 	char *partial_clone; /* value of extensions.partialclone */
+	char *ref_storage; /* value of extensions.refStorage */
 	int is_bare;
 	int hash_algo;
 	char *work_tree;
@@ -1692,6 +1714,12 @@ struct object_info {
 #define OBJECT_INFO_QUICK 8
 /* Do not check loose object */
 #define OBJECT_INFO_IGNORE_LOOSE 16
+/*
+ * Allow existence checks to be answered from the per-subdirectory
+ * readdir caches, which are never invalidated; only for callers that
+ * can tolerate a racy answer.
+ */
+#define OBJECT_INFO_QUICK_LOOSE_CACHE 32
 extern int oid_object_info_extended(const struct object_id *, struct object_info *, unsigned flags);
 
 /*
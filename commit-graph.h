@@ -0,0 +1,78 @@
+#ifndef COMMIT_GRAPH_H
+#define COMMIT_GRAPH_H
+
+#include "git-compat-util.h"
+
+struct bloom_filter;
+struct bloom_filter_settings;
+
+char *get_commit_graph_filename(const char *obj_dir);
+
+/*
+ * Given a commit struct, try to fill the commit struct info, including:
+ *  1. tree object
+ *  2. date
+ *  3. parents
+ *  4. generation number
+ *
+ * Returns 1 if and only if the commit was found in the packed graph.
+ *
+ * See parse_commit_buffer() for the fallback after this call.
+ */
+int parse_commit_in_graph(struct commit *item);
+
+/*
+ * It is possible that we loaded commit contents from the commit buffer,
+ * but we also want to ensure the commit-graph content is correctly
+ * checked and filled. Fill the graph_pos and generation members of
+ * the given commit.
+ */
+void load_commit_graph_info(struct commit *item);
+
+/*
+ * Returns 1 when a commit graph with computed generation numbers is
+ * available, so walks may rely on generation-based cutoffs.
+ */
+int generation_numbers_enabled(void);
+
+struct commit_graph {
+	int graph_fd;
+
+	const unsigned char *data;
+	size_t data_len;
+
+	unsigned char hash_len;
+	unsigned char num_chunks;
+	uint32_t num_commits;
+	struct object_id oid;
+
+	const uint32_t *chunk_oid_fanout;
+	const unsigned char *chunk_oid_lookup;
+	const unsigned char *chunk_commit_data;
+	const unsigned char *chunk_large_edges;
+	const unsigned char *chunk_bloom_indexes;
+	const unsigned char *chunk_bloom_data;
+
+	struct bloom_filter_settings *bloom_filter_settings;
+};
+
+struct commit_graph *load_commit_graph_one(const char *graph_file);
+
+/*
+ * Returns the changed-path filter settings of the loaded commit graph,
+ * or NULL if no graph is loaded or it carries no filters.
+ */
+struct bloom_filter_settings *get_bloom_filter_settings(void);
+
+/*
+ * Point 'filter' at the serialized changed-path filter of the given
+ * commit. Returns 0 when the commit is not in the graph or the graph
+ * has no filter data. The filter borrows the mmap'd graph data and
+ * must not be freed.
+ */
+int load_bloom_filter_for_commit(const struct commit *c,
+				 struct bloom_filter *filter);
+
+void write_commit_graph(const char *obj_dir, int changed_paths);
+
+#endif
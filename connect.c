@@ -15,6 +15,16 @@
 #include "protocol.h"
 
 static char *server_capabilities;
+static struct strbuf protocol_extra_params = STRBUF_INIT;
+
+void add_advertise_ref_prefix(const char *prefix)
+{
+	/*
+	 * Refnames cannot contain ':', so the prefix can safely be
+	 * smuggled in the colon-separated GIT_PROTOCOL value.
+	 */
+	strbuf_addf(&protocol_extra_params, ":ref-prefix=%s", prefix);
+}
 static const char *parse_feature_value(const char *, const char *, int *);
 
 static int check_ref(const char *name, unsigned int flags)
@@ -912,8 +922,9 @@ static struct child_process *git_connect_git(int fd[2], char *hostandport,
 	/* If using a new version put that stuff here after a second null byte */
 	if (get_protocol_version_config() > 0) {
 		strbuf_addch(&request, '\0');
-		strbuf_addf(&request, "version=%d%c",
-			    get_protocol_version_config(), '\0');
+		strbuf_addf(&request, "version=%d%s%c",
+			    get_protocol_version_config(),
+			    protocol_extra_params.buf, '\0');
 	}
 
 	packet_write(fd[1], request.buf, request.len);
@@ -935,8 +946,9 @@ static void push_ssh_options(struct argv_array *args, struct argv_array *env,
 	    get_protocol_version_config() > 0) {
 		argv_array_push(args, "-o");
 		argv_array_push(args, "SendEnv=" GIT_PROTOCOL_ENVIRONMENT);
-		argv_array_pushf(env, GIT_PROTOCOL_ENVIRONMENT "=version=%d",
-				 get_protocol_version_config());
+		argv_array_pushf(env, GIT_PROTOCOL_ENVIRONMENT "=version=%d%s",
+				 get_protocol_version_config(),
+				 protocol_extra_params.buf);
 	}
 
 	if (flags & CONNECT_IPV4) {
@@ -1112,8 +1124,9 @@ struct child_process *git_connect(int fd[2], const char *url,
 		} else {
 			transport_check_allowed("file");
 			if (get_protocol_version_config() > 0) {
-				argv_array_pushf(&conn->env_array, GIT_PROTOCOL_ENVIRONMENT "=version=%d",
-						 get_protocol_version_config());
+				argv_array_pushf(&conn->env_array, GIT_PROTOCOL_ENVIRONMENT "=version=%d%s",
+						 get_protocol_version_config(),
+						 protocol_extra_params.buf);
 			}
 		}
 		argv_array_push(&conn->args, cmd.buf);
@@ -13,4 +13,11 @@ extern int parse_feature_request(const char *features, const char *feature);
 extern const char *server_feature_value(const char *feature, int *len_ret);
 extern int url_is_local_not_ssh(const char *url);
 
+/*
+ * Ask the server (via the GIT_PROTOCOL side channel, so only effective
+ * with protocol.version >= 1) to limit its ref advertisement to refs
+ * matching the given prefix. May be called multiple times.
+ */
+extern void add_advertise_ref_prefix(const char *prefix);
+
 #endif
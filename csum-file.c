@@ -11,6 +11,28 @@
 #include "progress.h"
 #include "csum-file.h"
 
+#define WRITEBACK_WINDOW (8 * 1024 * 1024)
+
+void hashfile_background_writeback(struct hashfile *f)
+{
+	f->background_writeback = 1;
+	f->writeback_mark = f->total;
+}
+
+static void maybe_start_writeback(struct hashfile *f)
+{
+#ifdef __linux__
+	if (!f->background_writeback)
+		return;
+	if (f->total - f->writeback_mark < WRITEBACK_WINDOW)
+		return;
+	sync_file_range(f->fd, f->writeback_mark,
+			f->total - f->writeback_mark,
+			SYNC_FILE_RANGE_WRITE);
+	f->writeback_mark = f->total;
+#endif
+}
+
 static void flush(struct hashfile *f, const void *buf, unsigned int count)
 {
 	if (0 <= f->check_fd && count)  {
@@ -30,6 +52,7 @@ static void flush(struct hashfile *f, const void *buf, unsigned int count)
 		if (ret > 0) {
 			f->total += ret;
 			display_throughput(f->tp, f->total);
+			maybe_start_writeback(f);
 			buf = (char *) buf + ret;
 			count -= ret;
 			if (count)
@@ -61,11 +84,11 @@ int hashclose(struct hashfile *f, unsigned char *result, unsigned int flags)
 	the_hash_algo->final_fn(f->buffer, &f->ctx);
 	if (result)
 		hashcpy(result, f->buffer);
-	if (flags & (CSUM_CLOSE | CSUM_FSYNC)) {
-		/* write checksum and close fd */
+	if (flags & CSUM_HASH_IN_STREAM)
 		flush(f, f->buffer, the_hash_algo->rawsz);
-		if (flags & CSUM_FSYNC)
-			fsync_or_die(f->fd, f->name);
+	if (flags & CSUM_FSYNC)
+		fsync_or_die(f->fd, f->name);
+	if (flags & CSUM_CLOSE) {
 		if (close(f->fd))
 			die_errno("%s: sha1 file error on close", f->name);
 		fd = 0;
@@ -146,6 +169,8 @@ struct hashfile *hashfd_throughput(int fd, const char *name, struct progress *tp
 	f->check_fd = -1;
 	f->offset = 0;
 	f->total = 0;
+	f->writeback_mark = 0;
+	f->background_writeback = 0;
 	f->tp = tp;
 	f->name = name;
 	f->do_crc = 0;
@@ -10,6 +10,8 @@ struct hashfile {
 	unsigned int offset;
 	git_hash_ctx ctx;
 	off_t total;
+	off_t writeback_mark;
+	unsigned int background_writeback : 1;
 	struct progress *tp;
 	const char *name;
 	int do_crc;
@@ -27,10 +29,19 @@ extern void hashfile_checkpoint(struct hashfile *, struct hashfile_checkpoint *)
 extern int hashfile_truncate(struct hashfile *, struct hashfile_checkpoint *);
 
 /* hashclose flags */
-#define CSUM_CLOSE	1
-#define CSUM_FSYNC	2
+#define CSUM_CLOSE		1
+#define CSUM_FSYNC		2
+#define CSUM_HASH_IN_STREAM	4
 
 extern struct hashfile *hashfd(int fd, const char *name);
+
+/*
+ * Kick off asynchronous writeback of completed regions every few
+ * megabytes, so a huge pack write does not dam up dirty pages until
+ * the final fsync evicts everything at once. No-op on platforms
+ * without sync_file_range().
+ */
+extern void hashfile_background_writeback(struct hashfile *);
 extern struct hashfile *hashfd_check(const char *name);
 extern struct hashfile *hashfd_throughput(int fd, const char *name, struct progress *tp);
 extern int hashclose(struct hashfile *, unsigned char *, unsigned int);
@@ -0,0 +1,194 @@
+#include "cache.h"
+#include "config.h"
+#include "commit.h"
+#include "tag.h"
+#include "tree.h"
+#include "tree-walk.h"
+#include "oidmap.h"
+#include "refs.h"
+#include "delta-islands.h"
+
+/*
+ * Island membership per object, as a 64-bit set. Configurations with
+ * more than 64 islands alias into the same bits; that only makes the
+ * partitioning coarser (some cross-island deltas are permitted), it
+ * never produces a broken pack.
+ */
+struct island_marks_entry {
+	struct oidmap_entry entry;
+	uint64_t bits;
+};
+
+static struct oidmap island_marks = OIDMAP_INIT;
+static int island_nr;
+
+static uint64_t *get_marks(const struct object_id *oid, int create)
+{
+	struct island_marks_entry *e = oidmap_get(&island_marks, oid);
+
+	if (!e) {
+		if (!create)
+			return NULL;
+		e = xcalloc(1, sizeof(*e));
+		oidcpy(&e->entry.oid, oid);
+		oidmap_put(&island_marks, e);
+	}
+	return &e->bits;
+}
+
+int in_same_island(const struct object_id *trg_oid, const struct object_id *src_oid)
+{
+	uint64_t *trg, *src;
+
+	if (!island_nr)
+		return 1;
+
+	/*
+	 * If the target isn't in an island, it can be a delta against
+	 * anything.
+	 */
+	trg = get_marks(trg_oid, 0);
+	if (!trg || !*trg)
+		return 1;
+
+	/*
+	 * Otherwise, the base must be reachable from every island that
+	 * can reach the target.
+	 */
+	src = get_marks(src_oid, 0);
+	if (!src)
+		return 0;
+	return (*trg & *src) == *trg;
+}
+
+static void mark_tree(const struct object_id *oid, uint64_t bits);
+
+static void mark_tree_contents(struct tree *tree, uint64_t bits)
+{
+	struct tree_desc desc;
+	struct name_entry entry;
+
+	if (parse_tree_gently(tree, 1) < 0)
+		return;
+
+	init_tree_desc(&desc, tree->buffer, tree->size);
+	while (tree_entry(&desc, &entry)) {
+		if (S_ISGITLINK(entry.mode))
+			continue;
+		if (S_ISDIR(entry.mode))
+			mark_tree(entry.oid, bits);
+		else {
+			uint64_t *marks = get_marks(entry.oid, 1);
+			*marks |= bits;
+		}
+	}
+	free_tree_buffer(tree);
+}
+
+static void mark_tree(const struct object_id *oid, uint64_t bits)
+{
+	struct tree *tree = lookup_tree(oid);
+	uint64_t *marks;
+
+	if (!tree)
+		return;
+	marks = get_marks(oid, 1);
+	if ((*marks & bits) == bits)
+		return; /* already marked; so is everything below */
+	*marks |= bits;
+	mark_tree_contents(tree, bits);
+}
+
+static void mark_commit_and_ancestors(struct commit *commit, uint64_t bits)
+{
+	struct commit_list *queue = NULL;
+
+	commit_list_insert(commit, &queue);
+	while (queue) {
+		struct commit *c = pop_commit(&queue);
+		struct commit_list *p;
+		uint64_t *marks = get_marks(&c->object.oid, 1);
+
+		if ((*marks & bits) == bits)
+			continue;
+		*marks |= bits;
+
+		if (parse_commit_gently(c, 1) < 0)
+			continue;
+		mark_tree(&c->tree->object.oid, bits);
+		for (p = c->parents; p; p = p->next)
+			commit_list_insert(p->item, &queue);
+	}
+}
+
+struct island_load_data {
+	regex_t *rx;
+	int nr, alloc;
+};
+
+static int find_island_for_ref(const char *refname, const struct object_id *oid,
+			       int flags, void *cb_data)
+{
+	struct island_load_data *ild = cb_data;
+	struct object *obj;
+	int i;
+	uint64_t bits = 0;
+
+	for (i = 0; i < ild->nr; i++)
+		if (!regexec(&ild->rx[i], refname, 0, NULL, 0))
+			bits |= (uint64_t)1 << (i % 64);
+
+	if (!bits)
+		return 0;
+
+	obj = parse_object(oid);
+	while (obj && obj->type == OBJ_TAG) {
+		uint64_t *marks = get_marks(&obj->oid, 1);
+		*marks |= bits;
+		obj = ((struct tag *)obj)->tagged;
+		if (obj)
+			obj = parse_object(&obj->oid);
+	}
+	if (obj && obj->type == OBJ_COMMIT)
+		mark_commit_and_ancestors((struct commit *)obj, bits);
+	else if (obj && obj->type == OBJ_TREE)
+		mark_tree(&obj->oid, bits);
+
+	return 0;
+}
+
+static int island_config_callback(const char *k, const char *v, void *cb)
+{
+	struct island_load_data *ild = cb;
+
+	if (!strcmp(k, "pack.island")) {
+		if (!v)
+			return config_error_nonbool(k);
+		ALLOC_GROW(ild->rx, ild->nr + 1, ild->alloc);
+		if (regcomp(&ild->rx[ild->nr], v, REG_EXTENDED | REG_NOSUB))
+			die(_("failed to load island regex for '%s': %s"), k, v);
+		ild->nr++;
+		return 0;
+	}
+
+	return 0;
+}
+
+int load_delta_islands(void)
+{
+	struct island_load_data ild = { NULL, 0, 0 };
+	int i;
+
+	git_config(island_config_callback, &ild);
+	if (!ild.nr)
+		return 0;
+	island_nr = ild.nr;
+
+	for_each_ref(find_island_for_ref, &ild);
+
+	for (i = 0; i < ild.nr; i++)
+		regfree(&ild.rx[i]);
+	free(ild.rx);
+
+	return island_nr;
+}
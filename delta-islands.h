@@ -0,0 +1,23 @@
+#ifndef DELTA_ISLANDS_H
+#define DELTA_ISLANDS_H
+
+struct object_id;
+
+/*
+ * Delta islands partition the refs into groups via the pack.island
+ * config regexes; the delta search then only pairs objects when
+ * everyone who can fetch the target can also fetch the base, so
+ * serving one fork never needs deltas against objects private to
+ * another fork.
+ *
+ * Returns the number of islands found; zero disables the check.
+ */
+int load_delta_islands(void);
+
+/*
+ * May 'trg' be stored as a delta against 'src'? True when src is
+ * reachable from every island that can reach trg.
+ */
+int in_same_island(const struct object_id *trg, const struct object_id *src);
+
+#endif /* DELTA_ISLANDS_H */
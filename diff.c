@@ -20,6 +20,7 @@
 #include "ll-merge.h"
 #include "string-list.h"
 #include "argv-array.h"
+#include "fetch-object.h"
 #include "graph.h"
 #include "packfile.h"
 
@@ -5817,8 +5818,45 @@ void diffcore_fix_diff_index(struct diff_options *options)
 	QSORT(q->queue, q->nr, diffnamecmp);
 }
 
+/*
+ * When blobs are omitted by a partial clone filter, fault in every
+ * missing blob of this diff queue with one request instead of letting
+ * diff_populate_filespec() fetch them one round trip at a time.
+ */
+static void diff_queued_prefetch(struct diff_options *options)
+{
+	int i, fetch_if_missing_store;
+	struct oid_array to_fetch = OID_ARRAY_INIT;
+
+	if (!repository_format_partial_clone || !fetch_if_missing)
+		return;
+
+	/* the existence probes must not fault objects in one by one */
+	fetch_if_missing_store = fetch_if_missing;
+	fetch_if_missing = 0;
+	for (i = 0; i < diff_queued_diff.nr; i++) {
+		struct diff_filepair *p = diff_queued_diff.queue[i];
+
+		if (DIFF_FILE_VALID(p->one) && p->one->oid_valid &&
+		    !S_ISGITLINK(p->one->mode) &&
+		    !has_object_file(&p->one->oid))
+			oid_array_append(&to_fetch, &p->one->oid);
+		if (DIFF_FILE_VALID(p->two) && p->two->oid_valid &&
+		    !S_ISGITLINK(p->two->mode) &&
+		    !has_object_file(&p->two->oid))
+			oid_array_append(&to_fetch, &p->two->oid);
+	}
+	fetch_if_missing = fetch_if_missing_store;
+
+	if (to_fetch.nr)
+		fetch_objects(repository_format_partial_clone, &to_fetch);
+	oid_array_clear(&to_fetch);
+}
+
 void diffcore_std(struct diff_options *options)
 {
+	diff_queued_prefetch(options);
+
 	/* NOTE please keep the following in sync with diff_tree_combined() */
 	if (options->skip_stat_unmatch)
 		diffcore_skip_stat_unmatch(options);
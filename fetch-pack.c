@@ -139,6 +139,28 @@ static int rev_list_insert_ref_oid(const char *refname, const struct object_id *
 	return rev_list_insert_ref(refname, oid);
 }
 
+static void insert_negotiation_tips(const struct string_list *tips)
+{
+	const struct string_list_item *item;
+
+	for_each_string_list_item(item, tips) {
+		const char *s = item->string;
+		struct object_id oid;
+
+		if (!get_oid(s, &oid)) {
+			rev_list_insert_ref(NULL, &oid);
+			continue;
+		}
+		if (strchr(s, '*')) {
+			if (!for_each_glob_ref(rev_list_insert_ref_oid,
+					       s, NULL))
+				continue;
+		}
+		warning(_("ignoring invalid negotiation tip '%s'"), s);
+	}
+}
+
+
 static int clear_marks(const char *refname, const struct object_id *oid,
 		       int flag, void *cb_data)
 {
@@ -188,6 +210,35 @@ static void mark_common(struct commit *commit,
   Get the next rev to send, ignoring the common.
 */
 
+/*
+ * With fetch.negotiationAlgorithm=skipping, only a geometrically
+ * thinning subset of the walked commits is sent as "have" lines, so
+ * catch-up fetches over weeks of divergence converge in tens of haves
+ * instead of one per commit. The walk itself is unchanged; skipped
+ * commits may cost the server a few redundant objects, which is the
+ * documented trade-off.
+ */
+static int use_skipping_negotiation;
+static const char *negotiation_algorithm;
+static unsigned int skip_emitted, skip_amount = 1, skip_countdown;
+
+static int skipping_should_emit(void)
+{
+	if (!use_skipping_negotiation)
+		return 1;
+	if (skip_countdown) {
+		skip_countdown--;
+		return 0;
+	}
+	if (++skip_emitted > 16) {
+		skip_amount = skip_amount * 2;
+		if (skip_amount > 1024)
+			skip_amount = 1024;
+	}
+	skip_countdown = skip_amount - 1;
+	return 1;
+}
+
 static const struct object_id *get_rev(void)
 {
 	struct commit *commit = NULL;
@@ -336,11 +387,19 @@ static int find_common(struct fetch_pack_args *args,
 
 	if (args->stateless_rpc && multi_ack == 1)
 		die(_("--stateless-rpc requires multi_ack_detailed"));
+
+	/* reset the skipping state for each negotiation */
+	skip_emitted = 0;
+	skip_amount = 1;
+	skip_countdown = 0;
 	if (marked)
 		for_each_ref(clear_marks, NULL);
 	marked = 1;
 
-	for_each_ref(rev_list_insert_ref_oid, NULL);
+	if (args->negotiation_tips && args->negotiation_tips->nr)
+		insert_negotiation_tips(args->negotiation_tips);
+	else
+		for_each_ref(rev_list_insert_ref_oid, NULL);
 	for_each_cached_alternate(insert_one_alternate_object);
 
 	fetching = 0;
@@ -460,6 +519,8 @@ static int find_common(struct fetch_pack_args *args,
 	if (args->no_dependents)
 		goto done;
 	while ((oid = get_rev())) {
+		if (!skipping_should_emit())
+			continue;
 		packet_buf_write(&req_buf, "have %s\n", oid_to_hex(oid));
 		print_verbose(args, "have %s", oid_to_hex(oid));
 		in_vain++;
@@ -754,7 +815,8 @@ static int everything_local(struct fetch_pack_args *args,
 
 	for (ref = *refs; ref; ref = ref->next) {
 		struct object *o;
-		unsigned int flags = OBJECT_INFO_QUICK;
+		unsigned int flags = OBJECT_INFO_QUICK |
+			OBJECT_INFO_QUICK_LOOSE_CACHE;
 
 		if (use_oidset &&
 		    !oidset_contains(&loose_oid_set, &ref->old_oid)) {
@@ -1088,6 +1150,15 @@ static void fetch_pack_config(void)
 	git_config_get_bool("fetch.fsckobjects", &fetch_fsck_objects);
 	git_config_get_bool("transfer.fsckobjects", &transfer_fsck_objects);
 
+	if (!git_config_get_string_const("fetch.negotiationalgorithm",
+					 &negotiation_algorithm)) {
+		if (!strcmp(negotiation_algorithm, "skipping"))
+			use_skipping_negotiation = 1;
+		else if (strcmp(negotiation_algorithm, "default"))
+			die(_("unknown fetch negotiation algorithm '%s'"),
+			    negotiation_algorithm);
+	}
+
 	git_config(git_default_config, NULL);
 }
 
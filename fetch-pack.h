@@ -13,6 +13,12 @@ struct fetch_pack_args {
 	int depth;
 	const char *deepen_since;
 	const struct string_list *deepen_not;
+	/*
+	 * Refnames, ref globs or object names whose reachable commits
+	 * seed the "have" negotiation; when empty, every local ref is
+	 * used.
+	 */
+	const struct string_list *negotiation_tips;
 	struct list_objects_filter_options filter_options;
 	unsigned deepen_relative:1;
 	unsigned quiet:1;
@@ -118,11 +118,38 @@ static int query_fsmonitor(int version, uint64_t last_update, struct strbuf *que
 
 static void fsmonitor_refresh_callback(struct index_state *istate, const char *name)
 {
-	int pos = index_name_pos(istate, name, strlen(name));
+	int i, len = strlen(name);
+	int pos = index_name_pos(istate, name, len);
 
 	if (pos >= 0) {
 		struct cache_entry *ce = istate->cache[pos];
 		ce->ce_flags &= ~CE_FSMONITOR_VALID;
+	} else {
+		/*
+		 * The path may be a directory (e.g. when it was moved or
+		 * deleted wholesale). With the untracked cache relying on
+		 * the monitor instead of per-directory stat data, a missed
+		 * directory event would go unnoticed forever, so mark
+		 * everything under it out of date. Search for "name/" so
+		 * that siblings sorting between "name" and "name/" (such
+		 * as "name.c"; '.' < '/') cannot cut the scan short.
+		 */
+		struct strbuf dir = STRBUF_INIT;
+
+		strbuf_add(&dir, name, len);
+		strbuf_addch(&dir, '/');
+		pos = index_name_pos(istate, dir.buf, dir.len);
+		if (pos < 0)
+			pos = -pos - 1;
+		for (i = pos; i < istate->cache_nr; i++) {
+			struct cache_entry *ce = istate->cache[i];
+
+			if (ce_namelen(ce) <= dir.len ||
+			    memcmp(ce->name, dir.buf, dir.len))
+				break;
+			ce->ce_flags &= ~CE_FSMONITOR_VALID;
+		}
+		strbuf_release(&dir);
 	}
 
 	/*
@@ -48,6 +48,7 @@ char curl_errorstr[CURL_ERROR_SIZE];
 
 static int curl_ssl_verify = -1;
 static int curl_ssl_try;
+static const char *curl_http_version;
 static const char *ssl_cert;
 static const char *ssl_cipherlist;
 static const char *ssl_version;
@@ -274,6 +275,9 @@ static void process_curl_messages(void)
 
 static int http_options(const char *var, const char *value, void *cb)
 {
+	if (!strcmp("http.version", var)) {
+		return git_config_string(&curl_http_version, var, value);
+	}
 	if (!strcmp("http.sslverify", var)) {
 		curl_ssl_verify = git_config_bool(var, value);
 		return 0;
@@ -763,6 +767,31 @@ static long get_curl_allowed_protocols(int from_user)
 }
 #endif
 
+#if LIBCURL_VERSION_NUM >= 0x073100
+static const struct {
+	const char *name;
+	long curlv;
+} curl_http_versions[] = {
+	{ "HTTP/1.1", CURL_HTTP_VERSION_1_1 },
+	{ "HTTP/2", CURL_HTTP_VERSION_2 }
+};
+
+static int get_curl_http_version_opt(const char *version_string, long *opt)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(curl_http_versions); i++) {
+		if (!strcmp(version_string, curl_http_versions[i].name)) {
+			*opt = curl_http_versions[i].curlv;
+			return 0;
+		}
+	}
+
+	warning("unknown value given to http.version: '%s'", version_string);
+	return -1; /* not found */
+}
+#endif
+
 static CURL *get_curl_handle(void)
 {
 	CURL *result = curl_easy_init();
@@ -770,6 +799,29 @@ static CURL *get_curl_handle(void)
 	if (!result)
 		die("curl_easy_init failed");
 
+#if LIBCURL_VERSION_NUM >= 0x073100
+	if (curl_http_version && !*curl_http_version) {
+		/* empty string: leave curl's own default alone */
+	} else if (curl_http_version) {
+		long opt;
+
+		if (!get_curl_http_version_opt(curl_http_version, &opt)) {
+			/* Set request use http version */
+			curl_easy_setopt(result, CURLOPT_HTTP_VERSION, opt);
+		}
+	} else {
+		/*
+		 * Multiplexing all requests of one process over a
+		 * single connection needs HTTP/2; ask for it (TLS
+		 * only, with a transparent 1.1 fallback), so the
+		 * info/refs probe, the upload-pack POST and subsequent
+		 * submodule fetches reuse one handshake.
+		 */
+		curl_easy_setopt(result, CURLOPT_HTTP_VERSION,
+				 CURL_HTTP_VERSION_2TLS);
+	}
+#endif
+
 	if (!curl_ssl_verify) {
 		curl_easy_setopt(result, CURLOPT_SSL_VERIFYPEER, 0);
 		curl_easy_setopt(result, CURLOPT_SSL_VERIFYHOST, 0);
@@ -1038,6 +1090,10 @@ void http_init(struct remote *remote, const char *url, int proactive_auth)
 	curlm = curl_multi_init();
 	if (!curlm)
 		die("curl_multi_init failed");
+#if LIBCURL_VERSION_NUM >= 0x072b00
+	/* let concurrent slots share one HTTP/2 connection */
+	curl_multi_setopt(curlm, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
 #endif
 
 	if (getenv("GIT_SSL_NO_VERIFY"))
@@ -984,6 +984,57 @@ static void dump_diff_hacky(struct rev_info *rev, struct line_log_data *range)
  * Unlike most other functions, this destructively operates on
  * 'range'.
  */
+/*
+ * Merge-heavy histories revisit the same (parent blob, target blob)
+ * pairs many times; the resulting line diff only depends on the two
+ * blobs, so memoize it.
+ */
+struct blob_pair_diff {
+	struct hashmap_entry entry;
+	struct object_id one, two;
+	struct diff_ranges diff;
+};
+
+static struct hashmap blob_pair_diff_map;
+
+static int blob_pair_diff_cmp(const void *unused_cmp_data,
+			      const void *entry, const void *entry_or_key,
+			      const void *unused_keydata)
+{
+	const struct blob_pair_diff *a = entry;
+	const struct blob_pair_diff *b = entry_or_key;
+
+	return oidcmp(&a->one, &b->one) || oidcmp(&a->two, &b->two);
+}
+
+static struct blob_pair_diff *blob_pair_diff_lookup(const struct object_id *one,
+						    const struct object_id *two)
+{
+	struct blob_pair_diff key;
+
+	if (!blob_pair_diff_map.cmpfn)
+		hashmap_init(&blob_pair_diff_map, blob_pair_diff_cmp, NULL, 0);
+
+	hashmap_entry_init(&key, sha1hash(one->hash) ^ sha1hash(two->hash));
+	oidcpy(&key.one, one);
+	oidcpy(&key.two, two);
+	return hashmap_get(&blob_pair_diff_map, &key, NULL);
+}
+
+static void blob_pair_diff_store(const struct object_id *one,
+				 const struct object_id *two,
+				 struct diff_ranges *diff)
+{
+	struct blob_pair_diff *e = xcalloc(1, sizeof(*e));
+
+	hashmap_entry_init(e, sha1hash(one->hash) ^ sha1hash(two->hash));
+	oidcpy(&e->one, one);
+	oidcpy(&e->two, two);
+	range_set_copy(&e->diff.parent, &diff->parent);
+	range_set_copy(&e->diff.target, &diff->target);
+	hashmap_add(&blob_pair_diff_map, e);
+}
+
 static int process_diff_filepair(struct rev_info *rev,
 				 struct diff_filepair *pair,
 				 struct line_log_data *range,
@@ -1022,7 +1073,21 @@ static int process_diff_filepair(struct rev_info *rev,
 	}
 
 	diff_ranges_init(&diff);
-	if (collect_diff(&file_parent, &file_target, &diff))
+	if (pair->one->oid_valid) {
+		struct blob_pair_diff *cached =
+			blob_pair_diff_lookup(&pair->one->oid, &pair->two->oid);
+
+		if (cached) {
+			range_set_copy(&diff.parent, &cached->diff.parent);
+			range_set_copy(&diff.target, &cached->diff.target);
+		} else {
+			if (collect_diff(&file_parent, &file_target, &diff))
+				die("unable to generate diff for %s",
+				    pair->one->path);
+			blob_pair_diff_store(&pair->one->oid, &pair->two->oid,
+					     &diff);
+		}
+	} else if (collect_diff(&file_parent, &file_target, &diff))
 		die("unable to generate diff for %s", pair->one->path);
 
 	/* NEEDSWORK should apply some heuristics to prevent mismatches */
@@ -0,0 +1,528 @@
+#include "cache.h"
+#include "config.h"
+#include "csum-file.h"
+#include "dir.h"
+#include "lockfile.h"
+#include "object-store.h"
+#include "packfile.h"
+#include "sha1-lookup.h"
+#include "midx.h"
+
+#define MIDX_SIGNATURE 0x4d494458 /* "MIDX" */
+#define MIDX_VERSION 1
+#define MIDX_OID_VERSION_SHA1 1
+#define MIDX_OID_VERSION MIDX_OID_VERSION_SHA1
+#define MIDX_OID_LEN GIT_SHA1_RAWSZ
+#define MIDX_HEADER_SIZE 12
+#define MIDX_CHUNKLOOKUP_WIDTH 12
+#define MIDX_MIN_SIZE (MIDX_HEADER_SIZE + GIT_SHA1_RAWSZ)
+
+#define MIDX_CHUNKID_PACKNAMES 0x504e414d /* "PNAM" */
+#define MIDX_CHUNKID_OIDFANOUT 0x4f494446 /* "OIDF" */
+#define MIDX_CHUNKID_OIDLOOKUP 0x4f49444c /* "OIDL" */
+#define MIDX_CHUNKID_OBJECTOFFSETS 0x4f4f4646 /* "OOFF" */
+
+#define MIDX_CHUNK_FANOUT_SIZE (4 * 256)
+#define MIDX_CHUNK_OFFSET_WIDTH (2 * sizeof(uint32_t))
+
+char *get_midx_filename(const char *object_dir)
+{
+	return xstrfmt("%s/pack/multi-pack-index", object_dir);
+}
+
+struct multi_pack_index *load_multi_pack_index(const char *object_dir)
+{
+	struct multi_pack_index *m = NULL;
+	int fd;
+	struct stat st;
+	void *midx_map = NULL;
+	size_t midx_size;
+	uint32_t i;
+	const char *cur_pack_name;
+	char *midx_name = get_midx_filename(object_dir);
+
+	fd = git_open(midx_name);
+
+	if (fd < 0)
+		goto cleanup_fail;
+	if (fstat(fd, &st)) {
+		error_errno(_("failed to read %s"), midx_name);
+		goto cleanup_fail;
+	}
+
+	midx_size = xsize_t(st.st_size);
+
+	if (midx_size < MIDX_MIN_SIZE) {
+		error(_("multi-pack-index file %s is too small"), midx_name);
+		goto cleanup_fail;
+	}
+
+	FREE_AND_NULL(midx_name);
+
+	midx_map = xmmap(NULL, midx_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	FLEX_ALLOC_STR(m, object_dir, object_dir);
+	m->midx_fd = fd;
+	m->data = midx_map;
+	m->data_len = midx_size;
+
+	if (get_be32(m->data) != MIDX_SIGNATURE) {
+		error(_("multi-pack-index signature 0x%08x does not match signature 0x%08x"),
+		      get_be32(m->data), MIDX_SIGNATURE);
+		goto cleanup_fail;
+	}
+
+	if (m->data[4] != MIDX_VERSION) {
+		error(_("multi-pack-index version %d not recognized"), m->data[4]);
+		goto cleanup_fail;
+	}
+
+	if (m->data[5] != MIDX_OID_VERSION) {
+		error(_("hash version %u does not match"), m->data[5]);
+		goto cleanup_fail;
+	}
+
+	m->num_packs = get_be32(m->data + 8);
+
+	for (i = 0; i < m->data[6]; i++) {
+		uint32_t chunk_id = get_be32(m->data + MIDX_HEADER_SIZE +
+					     MIDX_CHUNKLOOKUP_WIDTH * i);
+		uint64_t chunk_offset = get_be64(m->data + MIDX_HEADER_SIZE + 4 +
+						 MIDX_CHUNKLOOKUP_WIDTH * i);
+
+		if (chunk_offset > midx_size - MIDX_OID_LEN) {
+			error(_("invalid chunk offset (too large)"));
+			goto cleanup_fail;
+		}
+
+		switch (chunk_id) {
+		case MIDX_CHUNKID_PACKNAMES:
+			m->chunk_pack_names = m->data + chunk_offset;
+			break;
+
+		case MIDX_CHUNKID_OIDFANOUT:
+			m->chunk_oid_fanout = (uint32_t *)(m->data + chunk_offset);
+			break;
+
+		case MIDX_CHUNKID_OIDLOOKUP:
+			m->chunk_oid_lookup = m->data + chunk_offset;
+			break;
+
+		case MIDX_CHUNKID_OBJECTOFFSETS:
+			m->chunk_object_offsets = m->data + chunk_offset;
+			break;
+
+		case 0:
+			break;
+
+		default:
+			/*
+			 * Do nothing on unrecognized chunks, allowing future
+			 * extensions to add optional chunks.
+			 */
+			break;
+		}
+	}
+
+	if (!m->chunk_pack_names) {
+		error(_("multi-pack-index missing required pack-name chunk"));
+		goto cleanup_fail;
+	}
+	if (!m->chunk_oid_fanout) {
+		error(_("multi-pack-index missing required OID fanout chunk"));
+		goto cleanup_fail;
+	}
+	if (!m->chunk_oid_lookup) {
+		error(_("multi-pack-index missing required OID lookup chunk"));
+		goto cleanup_fail;
+	}
+	if (!m->chunk_object_offsets) {
+		error(_("multi-pack-index missing required object offsets chunk"));
+		goto cleanup_fail;
+	}
+
+	m->num_objects = ntohl(m->chunk_oid_fanout[255]);
+
+	m->pack_names = xcalloc(m->num_packs, sizeof(*m->pack_names));
+	m->packs = xcalloc(m->num_packs, sizeof(*m->packs));
+
+	cur_pack_name = (const char *)m->chunk_pack_names;
+	for (i = 0; i < m->num_packs; i++) {
+		m->pack_names[i] = cur_pack_name;
+
+		cur_pack_name += strlen(cur_pack_name) + 1;
+
+		if (i && strcmp(m->pack_names[i], m->pack_names[i - 1]) <= 0) {
+			error(_("multi-pack-index pack names out of order: '%s' before '%s'"),
+			      m->pack_names[i - 1],
+			      m->pack_names[i]);
+			goto cleanup_fail;
+		}
+	}
+
+	return m;
+
+cleanup_fail:
+	free(m);
+	free(midx_name);
+	if (midx_map)
+		munmap(midx_map, midx_size);
+	if (0 <= fd)
+		close(fd);
+	return NULL;
+}
+
+static int prepare_midx_pack(struct multi_pack_index *m, uint32_t pack_int_id)
+{
+	struct strbuf pack_name = STRBUF_INIT;
+
+	if (pack_int_id >= m->num_packs)
+		BUG("bad pack-int-id %u (num packs %u)",
+		    pack_int_id, m->num_packs);
+
+	if (m->packs[pack_int_id])
+		return 0;
+
+	strbuf_addf(&pack_name, "%s/pack/%s", m->object_dir,
+		    m->pack_names[pack_int_id]);
+
+	m->packs[pack_int_id] = add_packed_git(pack_name.buf, pack_name.len, 1);
+	strbuf_release(&pack_name);
+	return !m->packs[pack_int_id];
+}
+
+static int bsearch_midx(const unsigned char *sha1, struct multi_pack_index *m,
+			uint32_t *result)
+{
+	return bsearch_hash(sha1, m->chunk_oid_fanout, m->chunk_oid_lookup,
+			    MIDX_OID_LEN, result);
+}
+
+int fill_midx_entry(const unsigned char *sha1, struct pack_entry *e,
+		    struct multi_pack_index *m)
+{
+	uint32_t pos;
+	uint32_t pack_int_id;
+	off_t offset;
+	const unsigned char *offset_data;
+	struct packed_git *p;
+
+	if (!bsearch_midx(sha1, m, &pos))
+		return 0;
+
+	if (pos >= m->num_objects)
+		return 0;
+
+	offset_data = m->chunk_object_offsets + pos * MIDX_CHUNK_OFFSET_WIDTH;
+	pack_int_id = get_be32(offset_data);
+	offset = get_be32(offset_data + sizeof(uint32_t));
+
+	if (prepare_midx_pack(m, pack_int_id))
+		return 0;
+	p = m->packs[pack_int_id];
+
+	/*
+	 * We are about to tell the caller where they can locate the
+	 * requested object.  We better make sure the packfile is
+	 * still here and can be accessed before supplying that
+	 * answer, as it may have been deleted since the index was
+	 * loaded!
+	 */
+	if (!is_pack_valid(p))
+		return 0;
+
+	if (p->num_bad_objects) {
+		uint32_t i;
+		for (i = 0; i < p->num_bad_objects; i++)
+			if (!hashcmp(sha1, p->bad_object_sha1 + 20 * i))
+				return 0;
+	}
+
+	e->offset = offset;
+	e->p = p;
+	hashcpy(e->sha1, sha1);
+	return 1;
+}
+
+int midx_contains_pack(struct multi_pack_index *m, const char *idx_name)
+{
+	uint32_t first = 0, last = m->num_packs;
+
+	while (first < last) {
+		uint32_t mid = first + (last - first) / 2;
+		const char *current;
+		int cmp;
+
+		current = m->pack_names[mid];
+		cmp = strcmp(idx_name, current);
+		if (!cmp)
+			return 1;
+		if (cmp > 0) {
+			first = mid + 1;
+			continue;
+		}
+		last = mid;
+	}
+
+	return 0;
+}
+
+struct pack_list {
+	struct packed_git **list;
+	char **names;
+	uint32_t nr;
+	uint32_t alloc_list;
+	uint32_t alloc_names;
+};
+
+static int pack_has_large_offset(struct packed_git *p)
+{
+	uint32_t n;
+
+	for (n = 0; n < p->num_objects; n++)
+		if (nth_packed_object_offset(p, n) > 0x7fffffff)
+			return 1;
+	return 0;
+}
+
+static void add_pack_to_midx(struct pack_list *packs, const char *full_path,
+			     const char *file_name)
+{
+	struct packed_git *p;
+
+	if (!ends_with(file_name, ".idx"))
+		return;
+
+	p = add_packed_git(full_path, strlen(full_path), 0);
+	if (!p)
+		return;
+	if (open_pack_index(p)) {
+		warning(_("failed to open pack-index '%s'"), full_path);
+		close_pack(p);
+		free(p);
+		return;
+	}
+
+	/*
+	 * The object offset chunk stores 32-bit offsets; until a
+	 * large-offset chunk is added, leave oversized packs out of
+	 * the index so lookups fall back to their own .idx.
+	 */
+	if (pack_has_large_offset(p)) {
+		warning(_("not indexing pack with offsets beyond 2 GiB: %s"),
+			p->pack_name);
+		close_pack(p);
+		free(p);
+		return;
+	}
+
+	ALLOC_GROW(packs->list, packs->nr + 1, packs->alloc_list);
+	ALLOC_GROW(packs->names, packs->nr + 1, packs->alloc_names);
+	packs->list[packs->nr] = p;
+	packs->names[packs->nr] = xstrdup(file_name);
+	packs->nr++;
+}
+
+struct pack_midx_entry {
+	struct object_id oid;
+	uint32_t pack_int_id;
+	off_t offset;
+};
+
+static int midx_oid_compare(const void *_a, const void *_b)
+{
+	const struct pack_midx_entry *a = (const struct pack_midx_entry *)_a;
+	const struct pack_midx_entry *b = (const struct pack_midx_entry *)_b;
+	int cmp = oidcmp(&a->oid, &b->oid);
+
+	if (cmp)
+		return cmp;
+	if (a->pack_int_id < b->pack_int_id)
+		return -1;
+	if (a->pack_int_id > b->pack_int_id)
+		return 1;
+	return 0;
+}
+
+static int pack_name_compare(const void *_a, const void *_b)
+{
+	return strcmp(*(const char **)_a, *(const char **)_b);
+}
+
+int write_midx_file(const char *object_dir)
+{
+	unsigned char num_chunks = 4;
+	char *midx_name;
+	struct hashfile *f;
+	struct lock_file lk = LOCK_INIT;
+	struct pack_list packs = { NULL, NULL, 0, 0, 0 };
+	struct pack_midx_entry *entries = NULL;
+	uint32_t *pack_perm;
+	uint32_t nr_entries, alloc_entries, dedup_entries;
+	uint32_t i, cur_fanout, cur_name_offset;
+	uint64_t chunk_offsets[5];
+	uint32_t chunk_ids[5];
+	uint64_t pack_name_concat_len = 0;
+	struct strbuf pack_dir = STRBUF_INIT;
+	DIR *dir;
+	struct dirent *de;
+
+	strbuf_addf(&pack_dir, "%s/pack", object_dir);
+	dir = opendir(pack_dir.buf);
+	if (!dir) {
+		error_errno(_("unable to open pack directory: %s"),
+			    pack_dir.buf);
+		strbuf_release(&pack_dir);
+		return 1;
+	}
+
+	while ((de = readdir(dir)) != NULL) {
+		struct strbuf full_path = STRBUF_INIT;
+
+		if (is_dot_or_dotdot(de->d_name))
+			continue;
+
+		strbuf_addf(&full_path, "%s/%s", pack_dir.buf, de->d_name);
+		add_pack_to_midx(&packs, full_path.buf, de->d_name);
+		strbuf_release(&full_path);
+	}
+	closedir(dir);
+
+	/*
+	 * Sort the pack names so midx_contains_pack() can binary
+	 * search, and remember where each pack landed so object
+	 * entries can be tagged with the sorted pack-int-id.
+	 */
+	ALLOC_ARRAY(pack_perm, packs.nr ? packs.nr : 1);
+	{
+		char **sorted_names;
+		ALLOC_ARRAY(sorted_names, packs.nr ? packs.nr : 1);
+		COPY_ARRAY(sorted_names, packs.names, packs.nr);
+		QSORT(sorted_names, packs.nr, pack_name_compare);
+		for (i = 0; i < packs.nr; i++) {
+			uint32_t j;
+			for (j = 0; j < packs.nr; j++) {
+				if (!strcmp(packs.names[i], sorted_names[j])) {
+					pack_perm[i] = j;
+					break;
+				}
+			}
+		}
+		free(packs.names);
+		packs.names = sorted_names;
+	}
+
+	for (i = 0; i < packs.nr; i++)
+		pack_name_concat_len += strlen(packs.names[i]) + 1;
+
+	/* pad the chunk to a multiple of four bytes */
+	while (pack_name_concat_len & 3)
+		pack_name_concat_len++;
+
+	nr_entries = 0;
+	alloc_entries = 1024;
+	ALLOC_ARRAY(entries, alloc_entries);
+	for (i = 0; i < packs.nr; i++) {
+		struct packed_git *p = packs.list[i];
+		uint32_t n;
+
+		for (n = 0; n < p->num_objects; n++) {
+			struct pack_midx_entry *entry;
+			off_t offset = nth_packed_object_offset(p, n);
+
+			ALLOC_GROW(entries, nr_entries + 1, alloc_entries);
+			entry = &entries[nr_entries++];
+			nth_packed_object_oid(&entry->oid, p, n);
+			entry->pack_int_id = pack_perm[i];
+			entry->offset = offset;
+		}
+	}
+
+	QSORT(entries, nr_entries, midx_oid_compare);
+
+	dedup_entries = 0;
+	for (i = 0; i < nr_entries; i++) {
+		if (i && !oidcmp(&entries[i - 1].oid, &entries[i].oid))
+			continue;
+		entries[dedup_entries++] = entries[i];
+	}
+	nr_entries = dedup_entries;
+
+	midx_name = get_midx_filename(object_dir);
+	if (safe_create_leading_directories(midx_name))
+		die_errno(_("unable to create leading directories of %s"),
+			  midx_name);
+
+	hold_lock_file_for_update(&lk, midx_name, LOCK_DIE_ON_ERROR);
+	f = hashfd(lk.tempfile->fd, lk.tempfile->filename.buf);
+	FREE_AND_NULL(midx_name);
+
+	hashwrite_be32(f, MIDX_SIGNATURE);
+	hashwrite_u8(f, MIDX_VERSION);
+	hashwrite_u8(f, MIDX_OID_VERSION);
+	hashwrite_u8(f, num_chunks);
+	hashwrite_u8(f, 0); /* unused padding byte */
+	hashwrite_be32(f, packs.nr);
+
+	chunk_ids[0] = MIDX_CHUNKID_PACKNAMES;
+	chunk_offsets[0] = MIDX_HEADER_SIZE + (num_chunks + 1) * MIDX_CHUNKLOOKUP_WIDTH;
+	chunk_ids[1] = MIDX_CHUNKID_OIDFANOUT;
+	chunk_offsets[1] = chunk_offsets[0] + pack_name_concat_len;
+	chunk_ids[2] = MIDX_CHUNKID_OIDLOOKUP;
+	chunk_offsets[2] = chunk_offsets[1] + MIDX_CHUNK_FANOUT_SIZE;
+	chunk_ids[3] = MIDX_CHUNKID_OBJECTOFFSETS;
+	chunk_offsets[3] = chunk_offsets[2] + MIDX_OID_LEN * (uint64_t)nr_entries;
+	chunk_ids[4] = 0;
+	chunk_offsets[4] = chunk_offsets[3] + MIDX_CHUNK_OFFSET_WIDTH * (uint64_t)nr_entries;
+
+	for (i = 0; i <= num_chunks; i++) {
+		hashwrite_be32(f, chunk_ids[i]);
+		hashwrite_be32(f, chunk_offsets[i] >> 32);
+		hashwrite_be32(f, chunk_offsets[i]);
+	}
+
+	/* PNAM */
+	cur_name_offset = 0;
+	for (i = 0; i < packs.nr; i++) {
+		hashwrite(f, packs.names[i], strlen(packs.names[i]) + 1);
+		cur_name_offset += strlen(packs.names[i]) + 1;
+	}
+	while (cur_name_offset & 3) {
+		hashwrite_u8(f, 0);
+		cur_name_offset++;
+	}
+
+	/* OIDF */
+	cur_fanout = 0;
+	for (i = 0; i < 256; i++) {
+		while (cur_fanout < nr_entries &&
+		       entries[cur_fanout].oid.hash[0] == i)
+			cur_fanout++;
+		hashwrite_be32(f, cur_fanout);
+	}
+
+	/* OIDL */
+	for (i = 0; i < nr_entries; i++)
+		hashwrite(f, entries[i].oid.hash, MIDX_OID_LEN);
+
+	/* OOFF */
+	for (i = 0; i < nr_entries; i++) {
+		hashwrite_be32(f, entries[i].pack_int_id);
+		hashwrite_be32(f, entries[i].offset);
+	}
+
+	hashclose(f, NULL, CSUM_HASH_IN_STREAM | CSUM_FSYNC);
+	commit_lock_file(&lk);
+
+	for (i = 0; i < packs.nr; i++) {
+		close_pack(packs.list[i]);
+		free(packs.list[i]);
+		free(packs.names[i]);
+	}
+	free(packs.list);
+	free(packs.names);
+	free(entries);
+	free(pack_perm);
+	strbuf_release(&pack_dir);
+	return 0;
+}
@@ -0,0 +1,43 @@
+#ifndef MIDX_H
+#define MIDX_H
+
+#include "git-compat-util.h"
+
+struct pack_entry;
+struct repository;
+
+struct multi_pack_index {
+	int midx_fd;
+
+	const unsigned char *data;
+	size_t data_len;
+
+	uint32_t num_packs;
+	uint32_t num_objects;
+
+	const unsigned char *chunk_pack_names;
+	const uint32_t *chunk_oid_fanout;
+	const unsigned char *chunk_oid_lookup;
+	const unsigned char *chunk_object_offsets;
+
+	const char **pack_names;
+	struct packed_git **packs;
+	char object_dir[FLEX_ARRAY];
+};
+
+char *get_midx_filename(const char *object_dir);
+
+struct multi_pack_index *load_multi_pack_index(const char *object_dir);
+
+/*
+ * Search for the given object in the multi-pack-index, opening the
+ * containing pack on demand. Returns 1 and fills 'e' on success.
+ */
+int fill_midx_entry(const unsigned char *sha1, struct pack_entry *e,
+		    struct multi_pack_index *m);
+
+int midx_contains_pack(struct multi_pack_index *m, const char *idx_name);
+
+int write_midx_file(const char *object_dir);
+
+#endif
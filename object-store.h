@@ -1,6 +1,8 @@
 #ifndef OBJECT_STORE_H
 #define OBJECT_STORE_H
 
+struct multi_pack_index;
+
 struct alternate_object_database {
 	struct alternate_object_database *next;
 
@@ -103,6 +105,13 @@ struct raw_object_store {
 	/* A most-recently-used ordered version of the packed_git list. */
 	struct list_head packed_git_mru;
 
+	/*
+	 * A single index covering all packs in the object directory,
+	 * consulted before the per-pack MRU scan. Loaded only when
+	 * core.multiPackIndex is enabled.
+	 */
+	struct multi_pack_index *multi_pack_index;
+
 	/*
 	 * A fast, rough count of the number of objects in the repository.
 	 * These two fields are not meant for direct access. Use
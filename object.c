@@ -7,17 +7,52 @@
 #include "object-store.h"
 #include "packfile.h"
 
-static struct object **obj_hash;
-static int nr_objs, obj_hash_size;
+/*
+ * The object hash is split into OBJ_HASH_SHARDS independent
+ * open-addressed tables, selected by a byte of the object name that
+ * the in-shard probe hash does not consume. Single-threaded callers
+ * see no behavioral difference; the split is groundwork for the
+ * threaded walker, which will add a per-shard lock and a combined
+ * lookup-or-create primitive when it lands - per-shard locks alone
+ * cannot make the prevailing lookup-then-create call pattern safe.
+ */
+#define OBJ_HASH_SHARD_BITS 5
+#define OBJ_HASH_SHARDS (1 << OBJ_HASH_SHARD_BITS)
+
+static struct obj_hash_shard {
+	struct object **hash;
+	int nr_objs, size;
+} obj_shards[OBJ_HASH_SHARDS];
+
+static inline struct obj_hash_shard *obj_shard(const unsigned char *sha1)
+{
+	/*
+	 * Use a byte that is not part of the sha1hash() value feeding
+	 * the in-shard probe, so bucket selection stays uniform
+	 * regardless of endianness.
+	 */
+	return &obj_shards[sha1[4] & (OBJ_HASH_SHARDS - 1)];
+}
 
 unsigned int get_max_object_index(void)
 {
-	return obj_hash_size;
+	unsigned int i, max = 0;
+
+	for (i = 0; i < OBJ_HASH_SHARDS; i++)
+		max += obj_shards[i].size;
+	return max;
 }
 
 struct object *get_indexed_object(unsigned int idx)
 {
-	return obj_hash[idx];
+	unsigned int i;
+
+	for (i = 0; i < OBJ_HASH_SHARDS; i++) {
+		if (idx < (unsigned int)obj_shards[i].size)
+			return obj_shards[i].hash[idx];
+		idx -= obj_shards[i].size;
+	}
+	return NULL;
 }
 
 static const char *object_type_strings[] = {
@@ -88,16 +123,17 @@ struct object *lookup_object(const unsigned char *sha1)
 {
 	unsigned int i, first;
 	struct object *obj;
+	struct obj_hash_shard *shard = obj_shard(sha1);
 
-	if (!obj_hash)
+	if (!shard->hash)
 		return NULL;
 
-	first = i = hash_obj(sha1, obj_hash_size);
-	while ((obj = obj_hash[i]) != NULL) {
+	first = i = hash_obj(sha1, shard->size);
+	while ((obj = shard->hash[i]) != NULL) {
 		if (!hashcmp(sha1, obj->oid.hash))
 			break;
 		i++;
-		if (i == obj_hash_size)
+		if (i == (unsigned int)shard->size)
 			i = 0;
 	}
 	if (obj && i != first) {
@@ -106,51 +142,51 @@ struct object *lookup_object(const unsigned char *sha1)
 		 * that we do not need to walk the hash table the next
 		 * time we look for it.
 		 */
-		SWAP(obj_hash[i], obj_hash[first]);
+		SWAP(shard->hash[i], shard->hash[first]);
 	}
 	return obj;
 }
 
 /*
- * Increase the size of the hash map stored in obj_hash to the next
- * power of 2 (but at least 32).  Copy the existing values to the new
- * hash map.
+ * Increase the size of the given shard to the next power of 2 (but at
+ * least 32). Callers hold the shard lock when threading is enabled.
  */
-static void grow_object_hash(void)
+static void grow_object_hash(struct obj_hash_shard *shard)
 {
 	int i;
 	/*
 	 * Note that this size must always be power-of-2 to match hash_obj
 	 * above.
 	 */
-	int new_hash_size = obj_hash_size < 32 ? 32 : 2 * obj_hash_size;
+	int new_hash_size = shard->size < 32 ? 32 : 2 * shard->size;
 	struct object **new_hash;
 
 	new_hash = xcalloc(new_hash_size, sizeof(struct object *));
-	for (i = 0; i < obj_hash_size; i++) {
-		struct object *obj = obj_hash[i];
+	for (i = 0; i < shard->size; i++) {
+		struct object *obj = shard->hash[i];
 		if (!obj)
 			continue;
 		insert_obj_hash(obj, new_hash, new_hash_size);
 	}
-	free(obj_hash);
-	obj_hash = new_hash;
-	obj_hash_size = new_hash_size;
+	free(shard->hash);
+	shard->hash = new_hash;
+	shard->size = new_hash_size;
 }
 
 void *create_object(const unsigned char *sha1, void *o)
 {
 	struct object *obj = o;
+	struct obj_hash_shard *shard = obj_shard(sha1);
 
 	obj->parsed = 0;
 	obj->flags = 0;
 	hashcpy(obj->oid.hash, sha1);
 
-	if (obj_hash_size - 1 <= nr_objs * 2)
-		grow_object_hash();
+	if (shard->size - 1 <= shard->nr_objs * 2)
+		grow_object_hash(shard);
 
-	insert_obj_hash(obj, obj_hash, obj_hash_size);
-	nr_objs++;
+	insert_obj_hash(obj, shard->hash, shard->size);
+	shard->nr_objs++;
 	return obj;
 }
 
@@ -428,10 +464,10 @@ void object_array_remove_duplicates(struct object_array *array)
 
 void clear_object_flags(unsigned flags)
 {
-	int i;
+	unsigned int i, max = get_max_object_index();
 
-	for (i=0; i < obj_hash_size; i++) {
-		struct object *obj = obj_hash[i];
+	for (i = 0; i < max; i++) {
+		struct object *obj = get_indexed_object(i);
 		if (obj)
 			obj->flags &= ~flags;
 	}
@@ -439,10 +475,10 @@ void clear_object_flags(unsigned flags)
 
 void clear_commit_marks_all(unsigned int flags)
 {
-	int i;
+	unsigned int i, max = get_max_object_index();
 
-	for (i = 0; i < obj_hash_size; i++) {
-		struct object *obj = obj_hash[i];
+	for (i = 0; i < max; i++) {
+		struct object *obj = get_indexed_object(i);
 		if (obj && obj->type == OBJ_COMMIT)
 			obj->flags &= ~flags;
 	}
@@ -19,7 +19,12 @@
  */
 struct stored_bitmap {
 	unsigned char sha1[20];
+	/*
+	 * Decoded lazily on first lookup; until then, map_pos remembers
+	 * where in the mmap'd bitmap file the EWAH data lives.
+	 */
 	struct ewah_bitmap *root;
+	size_t map_pos;
 	struct stored_bitmap *xor;
 	int flags;
 };
@@ -86,6 +91,9 @@ static struct bitmap_index {
 	/* Bitmap result of the last performed walk */
 	struct bitmap *result;
 
+	/* The objects the other side told us it has */
+	struct bitmap *haves;
+
 	/* Version of the bitmap index */
 	unsigned int version;
 
@@ -93,13 +101,32 @@ static struct bitmap_index {
 
 } bitmap_git;
 
+static struct ewah_bitmap *decode_stored_bitmap(struct stored_bitmap *st)
+{
+	struct ewah_bitmap *b;
+	int bitmap_size;
+
+	if (st->root)
+		return st->root;
+
+	b = ewah_pool_new();
+	bitmap_size = ewah_read_mmap(b, bitmap_git.map + st->map_pos,
+				     bitmap_git.map_size - st->map_pos);
+	if (bitmap_size < 0)
+		die("Failed to load bitmap index (corrupted?)");
+	st->root = b;
+	return b;
+}
+
 static struct ewah_bitmap *lookup_stored_bitmap(struct stored_bitmap *st)
 {
 	struct ewah_bitmap *parent;
 	struct ewah_bitmap *composed;
 
 	if (st->xor == NULL)
-		return st->root;
+		return decode_stored_bitmap(st);
+
+	decode_stored_bitmap(st);
 
 	composed = ewah_pool_new();
 	parent = lookup_stored_bitmap(st->xor);
@@ -168,7 +195,7 @@ static int load_bitmap_header(struct bitmap_index *index)
 }
 
 static struct stored_bitmap *store_bitmap(struct bitmap_index *index,
-					  struct ewah_bitmap *root,
+					  size_t map_pos,
 					  const unsigned char *sha1,
 					  struct stored_bitmap *xor_with,
 					  int flags)
@@ -178,7 +205,8 @@ static struct stored_bitmap *store_bitmap(struct bitmap_index *index,
 	int ret;
 
 	stored = xmalloc(sizeof(struct stored_bitmap));
-	stored->root = root;
+	stored->root = NULL;
+	stored->map_pos = map_pos;
 	stored->xor = xor_with;
 	stored->flags = flags;
 	hashcpy(stored->sha1, sha1);
@@ -211,6 +239,28 @@ static inline uint8_t read_u8(const unsigned char *buffer, size_t *pos)
 
 #define MAX_XOR_OFFSET 160
 
+/*
+ * Skip over one serialized EWAH bitmap without decoding it; its
+ * length is fully determined by the header.
+ */
+static int skip_bitmap_1(struct bitmap_index *index)
+{
+	uint32_t buffer_size;
+	size_t len;
+
+	if (index->map_size - index->map_pos < 2 * sizeof(uint32_t))
+		return error("Failed to load bitmap index (corrupted?)");
+
+	buffer_size = get_be32(index->map + index->map_pos + sizeof(uint32_t));
+	len = 3 * sizeof(uint32_t) + st_mult(buffer_size, sizeof(eword_t));
+
+	if (index->map_size - index->map_pos < len)
+		return error("Failed to load bitmap index (corrupted?)");
+
+	index->map_pos += len;
+	return 0;
+}
+
 static int load_bitmap_entries_v1(struct bitmap_index *index)
 {
 	uint32_t i;
@@ -218,9 +268,9 @@ static int load_bitmap_entries_v1(struct bitmap_index *index)
 
 	for (i = 0; i < index->entry_count; ++i) {
 		int xor_offset, flags;
-		struct ewah_bitmap *bitmap = NULL;
 		struct stored_bitmap *xor_bitmap = NULL;
 		uint32_t commit_idx_pos;
+		size_t bitmap_pos;
 		const unsigned char *sha1;
 
 		commit_idx_pos = read_be32(index->map, &index->map_pos);
@@ -229,8 +279,8 @@ static int load_bitmap_entries_v1(struct bitmap_index *index)
 
 		sha1 = nth_packed_object_sha1(index->pack, commit_idx_pos);
 
-		bitmap = read_bitmap_1(index);
-		if (!bitmap)
+		bitmap_pos = index->map_pos;
+		if (skip_bitmap_1(index) < 0)
 			return -1;
 
 		if (xor_offset > MAX_XOR_OFFSET || xor_offset > i)
@@ -244,7 +294,7 @@ static int load_bitmap_entries_v1(struct bitmap_index *index)
 		}
 
 		recent_bitmaps[i % MAX_XOR_OFFSET] = store_bitmap(
-			index, bitmap, sha1, xor_bitmap, flags);
+			index, bitmap_pos, sha1, xor_bitmap, flags);
 	}
 
 	return 0;
@@ -388,6 +438,47 @@ static int bitmap_position(const unsigned char *sha1)
 	return (pos >= 0) ? pos : bitmap_position_extended(sha1);
 }
 
+int bitmaps_prove_reachable(const struct object_array *tips,
+			    const struct object_array *wants)
+{
+	struct bitmap *merged = NULL;
+	int i, ret = 0;
+
+	if (prepare_bitmap_git() < 0)
+		return 0;
+
+	for (i = 0; i < tips->nr; i++) {
+		struct object *o = tips->objects[i].item;
+		khiter_t hash_pos = kh_get_sha1(bitmap_git.bitmaps,
+						o->oid.hash);
+
+		if (hash_pos >= kh_end(bitmap_git.bitmaps))
+			continue;
+		if (!merged)
+			merged = bitmap_new();
+		bitmap_or_ewah(merged,
+			       lookup_stored_bitmap(
+					kh_value(bitmap_git.bitmaps,
+						 hash_pos)));
+	}
+	if (!merged)
+		return 0;
+
+	ret = 1;
+	for (i = 0; i < wants->nr; i++) {
+		int pos = bitmap_position_packfile(
+				wants->objects[i].item->oid.hash);
+
+		if (pos < 0 || !bitmap_get(merged, pos)) {
+			ret = 0;
+			break;
+		}
+	}
+
+	bitmap_free(merged);
+	return ret;
+}
+
 static int ext_index_add_object(struct object *object, const char *name)
 {
 	struct eindex *eindex = &bitmap_git.ext_index;
@@ -735,11 +826,30 @@ int prepare_bitmap_walk(struct rev_info *revs)
 		bitmap_and_not(wants_bitmap, haves_bitmap);
 
 	bitmap_git.result = wants_bitmap;
+	bitmap_git.haves = haves_bitmap;
 
-	bitmap_free(haves_bitmap);
 	return 0;
 }
 
+/*
+ * Can the client be assumed to have this object (so that a thin pack
+ * may delta against it)? Only meaningful after prepare_bitmap_walk()
+ * computed a haves side.
+ */
+int bitmap_has_sha1_in_uninteresting(const unsigned char *sha1)
+{
+	int pos;
+
+	if (!bitmap_git.haves)
+		return 0;
+
+	pos = bitmap_position_packfile(sha1);
+	if (pos < 0)
+		return 0;
+
+	return bitmap_get(bitmap_git.haves, pos);
+}
+
 int reuse_partial_packfile_from_bitmap(struct packed_git **packfile,
 				       uint32_t *entries,
 				       off_t *up_to)
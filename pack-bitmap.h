@@ -35,6 +35,20 @@ typedef int (*show_reachable_fn)(
 	off_t found_offset);
 
 int prepare_bitmap_git(void);
+
+/*
+ * Whether the last prepare_bitmap_walk() proved the peer has this
+ * object; lets thin packs keep on-disk deltas against "have" bases.
+ */
+int bitmap_has_sha1_in_uninteresting(const unsigned char *sha1);
+
+/*
+ * Returns 1 when every object in 'wants' is provably reachable from
+ * the union of the bitmapped commits among 'tips'; 0 means unknown
+ * (not unreachable), and callers must fall back to a real walk.
+ */
+int bitmaps_prove_reachable(const struct object_array *tips,
+			    const struct object_array *wants);
 void count_bitmap_commit_list(uint32_t *commits, uint32_t *trees, uint32_t *blobs, uint32_t *tags);
 void traverse_bitmap_commit_list(show_reachable_fn show_reachable);
 void test_bitmap_walk(struct rev_info *revs);
@@ -11,6 +11,12 @@ struct object_entry {
 	struct object_entry *delta_sibling; /* other deltified objects who
 					     * uses the same base as me
 					     */
+	const unsigned char *ext_base_sha1; /*
+					     * delta base object that stays
+					     * outside the pack but that the
+					     * peer is known to have (thin
+					     * packs over bitmaps)
+					     */
 	void *delta_data;	/* cached delta (uncompressed) */
 	unsigned long delta_size;	/* delta data size (uncompressed) */
 	unsigned long z_delta_size;	/* delta data size (compressed) */
@@ -78,4 +84,23 @@ static inline uint32_t pack_name_hash(const char *name)
 	return hash;
 }
 
+/*
+ * A variant that mixes every byte of the path into the result, so
+ * that files differing only in a deep directory prefix still sort
+ * apart. The final name component is hashed last and therefore still
+ * dominates neighborhood, keeping same-extension files adjacent.
+ */
+static inline uint32_t pack_full_name_hash(const char *name)
+{
+	const uint32_t bigp = 1234572167U;
+	uint32_t c, hash = bigp;
+
+	if (!name)
+		return 0;
+
+	while ((c = *name++) != 0)
+		hash = (hash * bigp) + c;
+	return hash ^ bigp;
+}
+
 #endif
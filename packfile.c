@@ -15,6 +15,7 @@
 #include "tree-walk.h"
 #include "tree.h"
 #include "object-store.h"
+#include "midx.h"
 
 char *odb_pack_name(struct strbuf *buf,
 		    const unsigned char *sha1,
@@ -304,7 +305,7 @@ void close_pack_index(struct packed_git *p)
 	}
 }
 
-static void close_pack(struct packed_git *p)
+void close_pack(struct packed_git *p)
 {
 	close_pack_windows(p);
 	close_pack_fd(p);
@@ -320,6 +321,15 @@ void close_all_packs(struct raw_object_store *o)
 			die("BUG: want to close pack marked 'do-not-close'");
 		else
 			close_pack(p);
+
+	if (o->multi_pack_index) {
+		struct multi_pack_index *m = o->multi_pack_index;
+		uint32_t i;
+
+		for (i = 0; i < m->num_packs; i++)
+			if (m->packs[i])
+				close_pack(m->packs[i]);
+	}
 }
 
 /*
@@ -884,12 +894,24 @@ static void prepare_packed_git_mru(struct repository *r)
 		list_add_tail(&p->mru, &r->objects->packed_git_mru);
 }
 
+static void prepare_multi_pack_index_one(struct repository *r)
+{
+	if (!core_multi_pack_index)
+		return;
+	if (r->objects->multi_pack_index)
+		return;
+
+	r->objects->multi_pack_index =
+		load_multi_pack_index(r->objects->objectdir);
+}
+
 static void prepare_packed_git(struct repository *r)
 {
 	struct alternate_object_database *alt;
 
 	if (r->objects->packed_git_initialized)
 		return;
+	prepare_multi_pack_index_one(r);
 	prepare_packed_git_one(r, r->objects->objectdir, 1);
 	prepare_alt_odb(r);
 	for (alt = r->objects->alt_odb_list; alt; alt = alt->next)
@@ -1300,12 +1322,23 @@ void clear_delta_base_cache(void)
 	}
 }
 
-static void add_delta_base_cache(struct packed_git *p, off_t base_offset,
+/*
+ * Add a base to the cache, taking ownership of 'base'. Returns 0 (and
+ * leaves ownership with the caller) when the entry was not admitted:
+ * a single base larger than a quarter of the cache would evict scores
+ * of small hot bases for one use, which is exactly the thrashing the
+ * cache is meant to prevent.
+ */
+static int add_delta_base_cache(struct packed_git *p, off_t base_offset,
 	void *base, unsigned long base_size, enum object_type type)
 {
-	struct delta_base_cache_entry *ent = xmalloc(sizeof(*ent));
+	struct delta_base_cache_entry *ent;
 	struct list_head *lru, *tmp;
 
+	if (base_size > delta_base_cache_limit / 4)
+		return 0;
+
+	ent = xmalloc(sizeof(*ent));
 	delta_base_cached += base_size;
 
 	list_for_each_safe(lru, tmp, &delta_base_cache_lru) {
@@ -1327,6 +1360,7 @@ static void add_delta_base_cache(struct packed_git *p, off_t base_offset,
 		hashmap_init(&delta_base_cache, delta_base_cache_hash_cmp, NULL, 0);
 	hashmap_entry_init(ent, pack_entry_hash(p, base_offset));
 	hashmap_add(&delta_base_cache, ent);
+	return 1;
 }
 
 int packed_object_info(struct packed_git *p, off_t obj_offset,
@@ -1586,12 +1620,13 @@ void *unpack_entry(struct packed_git *p, off_t obj_offset,
 		void *base = data;
 		void *external_base = NULL;
 		unsigned long delta_size, base_size = size;
-		int i;
+		int i, base_cached = 0;
 
 		data = NULL;
 
 		if (base)
-			add_delta_base_cache(p, obj_offset, base, base_size, type);
+			base_cached = add_delta_base_cache(p, obj_offset, base,
+							   base_size, type);
 
 		if (!base) {
 			/*
@@ -1630,6 +1665,8 @@ void *unpack_entry(struct packed_git *p, off_t obj_offset,
 			      "at offset %"PRIuMAX" from %s",
 			      (uintmax_t)curpos, p->pack_name);
 			data = NULL;
+			if (!base_cached && base != external_base)
+				free(base);
 			free(external_base);
 			continue;
 		}
@@ -1650,6 +1687,8 @@ void *unpack_entry(struct packed_git *p, off_t obj_offset,
 			error("failed to apply delta");
 
 		free(delta_data);
+		if (!base_cached && base != external_base)
+			free(base);
 		free(external_base);
 	}
 
@@ -1842,9 +1881,13 @@ int find_pack_entry(struct repository *r, const unsigned char *sha1, struct pack
 	struct list_head *pos;
 
 	prepare_packed_git(r);
-	if (!r->objects->packed_git)
+	if (!r->objects->packed_git && !r->objects->multi_pack_index)
 		return 0;
 
+	if (r->objects->multi_pack_index &&
+	    fill_midx_entry(sha1, e, r->objects->multi_pack_index))
+		return 1;
+
 	list_for_each(pos, &r->objects->packed_git_mru) {
 		struct packed_git *p = list_entry(pos, struct packed_git, mru);
 		if (fill_pack_entry(sha1, e, p)) {
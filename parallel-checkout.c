@@ -0,0 +1,132 @@
+#include "cache.h"
+#include "config.h"
+#include "convert.h"
+#include "progress.h"
+#include "run-command.h"
+#include "thread-utils.h"
+#include "parallel-checkout.h"
+
+void init_parallel_checkout(struct parallel_checkout *pc,
+			    const struct checkout *state)
+{
+	memset(pc, 0, sizeof(*pc));
+	pc->state = state;
+	pc->workers = 1;
+	pc->threshold = 100;
+
+	git_config_get_int("checkout.workers", &pc->workers);
+	git_config_get_int("checkout.thresholdforparallelism", &pc->threshold);
+
+	if (pc->workers < 1)
+		pc->workers = online_cpus();
+}
+
+int parallel_checkout_enqueue(struct parallel_checkout *pc,
+			      struct cache_entry *ce)
+{
+	struct stream_filter *filter;
+
+	if (pc->workers < 2)
+		return 0;
+	if (!S_ISREG(ce->ce_mode))
+		return 0;
+
+	/*
+	 * Workers write the blob contents verbatim, so anything that
+	 * needs smudging or eol conversion stays on the sequential
+	 * path, where the usual convert machinery runs.
+	 */
+	filter = get_stream_filter(ce->name, &ce->oid);
+	if (!filter || !is_null_stream_filter(filter))
+		return 0;
+
+	ALLOC_GROW(pc->items, pc->nr + 1, pc->alloc);
+	pc->items[pc->nr++] = ce;
+	return 1;
+}
+
+static int checkout_sequentially(struct parallel_checkout *pc,
+				 struct progress *progress, unsigned *cnt)
+{
+	int i, errs = 0;
+
+	for (i = 0; i < pc->nr; i++) {
+		errs |= checkout_entry(pc->items[i],
+				       (struct checkout *)pc->state, NULL);
+		display_progress(progress, ++*cnt);
+	}
+	return errs;
+}
+
+int run_parallel_checkout(struct parallel_checkout *pc,
+			  struct progress *progress, unsigned *cnt)
+{
+	struct child_process *workers;
+	int i, errs = 0;
+
+	if (!pc->nr)
+		return 0;
+	if (pc->nr < pc->threshold) {
+		errs = checkout_sequentially(pc, progress, cnt);
+		goto done;
+	}
+
+	workers = xcalloc(pc->workers, sizeof(*workers));
+	for (i = 0; i < pc->workers; i++) {
+		struct child_process *cp = &workers[i];
+
+		child_process_init(cp);
+		cp->git_cmd = 1;
+		cp->in = -1;
+		cp->no_stdout = 1;
+		argv_array_push(&cp->args, "checkout--worker");
+		if (start_command(cp))
+			die(_("cannot spawn checkout worker"));
+	}
+
+	for (i = 0; i < pc->nr; i++) {
+		struct cache_entry *ce = pc->items[i];
+		struct child_process *cp = &workers[i % pc->workers];
+		struct strbuf record = STRBUF_INIT;
+
+		strbuf_addf(&record, "%o %s %s", ce->ce_mode,
+			    oid_to_hex(&ce->oid), ce->name);
+		strbuf_addch(&record, '\0');
+		if (write_in_full(cp->in, record.buf, record.len) < 0)
+			die_errno(_("failed to feed checkout worker"));
+		strbuf_release(&record);
+	}
+
+	for (i = 0; i < pc->workers; i++) {
+		close(workers[i].in);
+		workers[i].in = -1;
+	}
+	for (i = 0; i < pc->workers; i++) {
+		if (finish_command(&workers[i]))
+			errs = 1;
+	}
+	free(workers);
+
+	/*
+	 * The workers cannot refresh the in-core index, so pick up the
+	 * stat information of what they wrote here.
+	 */
+	for (i = 0; i < pc->nr; i++) {
+		struct cache_entry *ce = pc->items[i];
+
+		if (pc->state->refresh_cache) {
+			struct stat st;
+
+			if (lstat(ce->name, &st))
+				errs = 1;
+			else
+				fill_stat_cache_info(ce, &st);
+		}
+		display_progress(progress, ++*cnt);
+	}
+
+done:
+	FREE_AND_NULL(pc->items);
+	pc->nr = pc->alloc = 0;
+	return errs;
+}
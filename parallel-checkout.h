@@ -0,0 +1,45 @@
+#ifndef PARALLEL_CHECKOUT_H
+#define PARALLEL_CHECKOUT_H
+
+struct cache_entry;
+struct checkout;
+struct progress;
+
+/*
+ * Parallel checkout: eligible cache entries are distributed to
+ * 'checkout.workers' child processes, which write the blob contents
+ * verbatim. Only regular files that need no content conversion are
+ * eligible; everything else keeps going through checkout_entry().
+ */
+struct parallel_checkout {
+	const struct checkout *state;
+	struct cache_entry **items;
+	int nr, alloc;
+	int workers;
+	int threshold;
+};
+
+/*
+ * Reads checkout.workers and checkout.thresholdForParallelism.
+ * With fewer than two workers the queue refuses all entries and
+ * callers fall back to the sequential path.
+ */
+void init_parallel_checkout(struct parallel_checkout *pc,
+			    const struct checkout *state);
+
+/*
+ * Returns 1 and queues the entry when it can be checked out by a
+ * worker; returns 0 when the caller must check it out itself.
+ */
+int parallel_checkout_enqueue(struct parallel_checkout *pc,
+			      struct cache_entry *ce);
+
+/*
+ * Write all queued entries and update their stat information.
+ * Returns the number of errors. 'cnt' is advanced for the given
+ * progress meter as entries complete.
+ */
+int run_parallel_checkout(struct parallel_checkout *pc,
+			  struct progress *progress, unsigned *cnt);
+
+#endif
@@ -5,10 +5,11 @@
 #include "pathspec.h"
 #include "dir.h"
 #include "fsmonitor.h"
+#include "thread-utils.h"
 
 #ifdef NO_PTHREADS
-static void preload_index(struct index_state *index,
-			  const struct pathspec *pathspec)
+void preload_index(struct index_state *index,
+		   const struct pathspec *pathspec)
 {
 	; /* nothing */
 }
@@ -17,12 +18,10 @@ static void preload_index(struct index_state *index,
 #include <pthread.h>
 
 /*
- * Mostly randomly chosen maximum thread counts: we
- * cap the parallelism to 20 threads, and we want
- * to have at least 500 lstat's per thread for it to
- * be worth starting a thread.
+ * We want to have at least 500 lstat's per thread for it to be worth
+ * starting a thread; beyond that the parallelism is bounded by the
+ * number of online CPUs.
  */
-#define MAX_PARALLEL (20)
 #define THREAD_COST (500)
 
 struct thread_data {
@@ -73,11 +72,11 @@ static void *preload_thread(void *_data)
 	return NULL;
 }
 
-static void preload_index(struct index_state *index,
-			  const struct pathspec *pathspec)
+void preload_index(struct index_state *index,
+		   const struct pathspec *pathspec)
 {
 	int threads, i, work, offset;
-	struct thread_data data[MAX_PARALLEL];
+	struct thread_data *data;
 	uint64_t start = getnanotime();
 
 	if (!core_preload_index)
@@ -88,11 +87,13 @@ static void preload_index(struct index_state *index,
 		threads = 2;
 	if (threads < 2)
 		return;
-	if (threads > MAX_PARALLEL)
-		threads = MAX_PARALLEL;
+	if (threads > online_cpus())
+		threads = online_cpus();
+	if (threads < 2)
+		threads = 2;
 	offset = 0;
 	work = DIV_ROUND_UP(index->cache_nr, threads);
-	memset(&data, 0, sizeof(data));
+	data = xcalloc(threads, sizeof(*data));
 	for (i = 0; i < threads; i++) {
 		struct thread_data *p = data+i;
 		p->index = index;
@@ -109,6 +110,7 @@ static void preload_index(struct index_state *index,
 		if (pthread_join(p->pthread, NULL))
 			die("unable to join threaded lstat");
 	}
+	free(data);
 	trace_performance_since(start, "preload index");
 }
 #endif
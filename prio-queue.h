@@ -51,4 +51,7 @@ extern void clear_prio_queue(struct prio_queue *);
 /* Reverse the LIFO elements */
 extern void prio_queue_reverse(struct prio_queue *);
 
+/* Return the topmost element without removing it, or NULL. */
+extern void *prio_queue_peek(struct prio_queue *);
+
 #endif /* PRIO_QUEUE_H */
@@ -20,6 +20,7 @@
 #include "split-index.h"
 #include "utf8.h"
 #include "fsmonitor.h"
+#include "sparse-index.h"
 
 /* Mask for the name length in ce_flags in the on-disk index */
 
@@ -40,6 +41,23 @@
 #define CACHE_EXT_LINK 0x6c696e6b	  /* "link" */
 #define CACHE_EXT_UNTRACKED 0x554E5452	  /* "UNTR" */
 #define CACHE_EXT_FSMONITOR 0x46534D4E	  /* "FSMN" */
+#define CACHE_EXT_SPARSE_DIRECTORIES 0x73646972 /* "sdir" */
+#define CACHE_EXT_ENDOFINDEXENTRIES 0x454F4945	/* "EOIE" */
+#define CACHE_EXT_INDEXENTRYOFFSETTABLE 0x49454F54 /* "IEOT" */
+
+#define EOIE_SIZE (4 + GIT_SHA1_RAWSZ)
+#define EOIE_SIZE_WITH_HEADER (4 + 4 + EOIE_SIZE)
+#define IEOT_VERSION (1)
+
+struct index_entry_offset {
+	/* starting byte offset into index file, count of index entries in this block */
+	int offset, nr;
+};
+
+struct index_entry_offset_table {
+	int nr;
+	struct index_entry_offset entries[FLEX_ARRAY];
+};
 
 /* changes that can be kept in $GIT_DIR/index (basically all extensions) */
 #define EXTMASK (RESOLVE_UNDO_CHANGED | CACHE_TREE_CHANGED | \
@@ -1380,6 +1398,12 @@ int refresh_index(struct index_state *istate, unsigned int flags,
 	typechange_fmt = (in_porcelain ? "T\t%s\n" : "%s needs update\n");
 	added_fmt = (in_porcelain ? "A\t%s\n" : "%s needs update\n");
 	unmerged_fmt = (in_porcelain ? "U\t%s\n" : "%s: needs merge\n");
+	/*
+	 * Use the multi-threaded preload_index() to refresh most of the
+	 * cache entries quickly then in the single threaded loop below,
+	 * we only have to do the special cases that are left.
+	 */
+	preload_index(istate, pathspec);
 	for (i = 0; i < istate->cache_nr; i++) {
 		struct cache_entry *ce, *new_entry;
 		int cache_errno = 0;
@@ -1589,6 +1613,14 @@ static int read_index_extension(struct index_state *istate,
 	case CACHE_EXT_FSMONITOR:
 		read_fsmonitor_extension(istate, data, sz);
 		break;
+	case CACHE_EXT_SPARSE_DIRECTORIES:
+		/* no content, only an indicator */
+		istate->sparse_index = 1;
+		break;
+	case CACHE_EXT_ENDOFINDEXENTRIES:
+	case CACHE_EXT_INDEXENTRYOFFSETTABLE:
+		/* already handled in do_read_index() */
+		break;
 	default:
 		if (*ext < 'A' || 'Z' < *ext)
 			return error("index uses %.4s extension, which we do not understand",
@@ -1767,12 +1799,234 @@ static void post_read_index_from(struct index_state *istate)
 	tweak_fsmonitor(istate);
 }
 
+
+static size_t read_eoie_extension(const char *mmap, size_t mmap_size)
+{
+	/*
+	 * The end of index entries (EOIE) extension is guaranteed to be
+	 * last so that it can be found by scanning backwards from the EOF.
+	 *
+	 * "EOIE"
+	 * <4-byte length>
+	 * <4-byte offset>
+	 * <20-byte hash>
+	 */
+	const char *index, *eoie;
+	uint32_t extsize;
+	size_t offset, src_offset;
+
+	/* ensure we have an index big enough to contain an EOIE extension */
+	if (mmap_size < sizeof(struct cache_header) + EOIE_SIZE_WITH_HEADER + the_hash_algo->rawsz)
+		return 0;
+
+	/* validate the extension signature */
+	index = eoie = mmap + mmap_size - EOIE_SIZE_WITH_HEADER - the_hash_algo->rawsz;
+	if (CACHE_EXT(index) != CACHE_EXT_ENDOFINDEXENTRIES)
+		return 0;
+	index += sizeof(uint32_t);
+
+	/* validate the extension size */
+	extsize = get_be32(index);
+	if (extsize != EOIE_SIZE)
+		return 0;
+	index += sizeof(uint32_t);
+
+	/*
+	 * Validate the offset we're going to use: it must point into the
+	 * mmapped area, before the EOIE extension itself, and at a
+	 * plausible extension header.
+	 */
+	offset = get_be32(index);
+	if (mmap + offset < mmap + sizeof(struct cache_header))
+		return 0;
+	if (mmap + offset >= eoie)
+		return 0;
+
+	src_offset = offset;
+	while (src_offset < mmap_size - the_hash_algo->rawsz - EOIE_SIZE_WITH_HEADER) {
+		extsize = get_be32(mmap + src_offset + 4);
+		src_offset += 8;
+		src_offset += extsize;
+	}
+	if (src_offset != mmap_size - the_hash_algo->rawsz - EOIE_SIZE_WITH_HEADER)
+		return 0;
+
+	return offset;
+}
+
+static struct index_entry_offset_table *read_ieot_extension(const char *mmap, size_t mmap_size, size_t offset)
+{
+	struct index_entry_offset_table *ieot;
+	int nr, i;
+	const char *index;
+	uint32_t extsize, ext_version;
+
+	/* find the IEOT extension */
+	if (!offset)
+		return NULL;
+	while (offset <= mmap_size - the_hash_algo->rawsz - 8) {
+		const char *ext = mmap + offset;
+
+		extsize = get_be32(mmap + offset + 4);
+		if (CACHE_EXT(ext) == CACHE_EXT_INDEXENTRYOFFSETTABLE)
+			break;
+		offset += 8;
+		offset += extsize;
+	}
+	if (offset > mmap_size - the_hash_algo->rawsz - 8)
+		return NULL;
+
+	index = mmap + offset + 8;
+
+	/* validate the version is IEOT_VERSION */
+	ext_version = get_be32(index);
+	if (ext_version != IEOT_VERSION)
+		return NULL;
+	index += sizeof(uint32_t);
+
+	/* extension size - version bytes / (appropriate size for an index_entry_offset) */
+	nr = (extsize - sizeof(uint32_t)) / (2 * sizeof(uint32_t));
+	if (!nr)
+		return NULL;
+	ieot = xmalloc(sizeof(struct index_entry_offset_table)
+		       + (nr * sizeof(struct index_entry_offset)));
+	ieot->nr = nr;
+	for (i = 0; i < nr; i++) {
+		ieot->entries[i].offset = get_be32(index);
+		index += sizeof(uint32_t);
+		ieot->entries[i].nr = get_be32(index);
+		index += sizeof(uint32_t);
+	}
+
+	return ieot;
+}
+
+static unsigned long load_cache_entry_block(struct index_state *istate,
+			int offset, int nr, const char *mmap,
+			unsigned long start_offset,
+			struct strbuf *previous_name)
+{
+	int i;
+	unsigned long src_offset = start_offset;
+
+	for (i = offset; i < offset + nr; i++) {
+		struct ondisk_cache_entry *disk_ce;
+		struct cache_entry *ce;
+		unsigned long consumed;
+
+		disk_ce = (struct ondisk_cache_entry *)(mmap + src_offset);
+		ce = create_from_disk(disk_ce, &consumed, previous_name);
+		istate->cache[i] = ce;
+
+		src_offset += consumed;
+	}
+	return src_offset - start_offset;
+}
+
+#ifndef NO_PTHREADS
+
+struct load_cache_entries_thread_data {
+	pthread_t pthread;
+	struct index_state *istate;
+	int offset, nr;		/* entries */
+	const char *mmap;
+	unsigned long src_offset; /* byte offset of this block */
+	unsigned long consumed;
+};
+
+static void *load_cache_entries_thread(void *_data)
+{
+	struct load_cache_entries_thread_data *p = _data;
+	struct strbuf previous_name_buf = STRBUF_INIT;
+	struct strbuf *previous_name = p->istate->version == 4
+		? &previous_name_buf : NULL;
+
+	p->consumed = load_cache_entry_block(p->istate, p->offset, p->nr,
+					     p->mmap, p->src_offset,
+					     previous_name);
+	strbuf_release(&previous_name_buf);
+	return NULL;
+}
+
+static unsigned long load_cache_entries_threaded(struct index_state *istate,
+			const char *mmap, int nr_threads,
+			struct index_entry_offset_table *ieot)
+{
+	int i, offset, ieot_blocks_per_thread, ieot_start;
+	struct load_cache_entries_thread_data *data;
+	unsigned long consumed = 0;
+
+	if (nr_threads > ieot->nr)
+		nr_threads = ieot->nr;
+	data = xcalloc(nr_threads, sizeof(*data));
+
+	ieot_blocks_per_thread = DIV_ROUND_UP(ieot->nr, nr_threads);
+	offset = 0;
+	ieot_start = 0;
+	for (i = 0; i < nr_threads; i++) {
+		struct load_cache_entries_thread_data *p = &data[i];
+		int j, blocks = ieot_blocks_per_thread;
+
+		if (ieot_start + blocks > ieot->nr)
+			blocks = ieot->nr - ieot_start;
+		p->istate = istate;
+		p->mmap = mmap;
+		p->offset = offset;
+		p->src_offset = ieot->entries[ieot_start].offset;
+		for (j = 0; j < blocks; j++)
+			p->nr += ieot->entries[ieot_start + j].nr;
+		offset += p->nr;
+		ieot_start += blocks;
+
+		if (pthread_create(&p->pthread, NULL,
+				   load_cache_entries_thread, p))
+			die(_("unable to create load_cache_entries thread"));
+	}
+	for (i = 0; i < nr_threads; i++) {
+		if (pthread_join(data[i].pthread, NULL))
+			die(_("unable to join load_cache_entries thread"));
+		consumed += data[i].consumed;
+	}
+	free(data);
+
+	return consumed;
+}
+
+#endif
+
+/*
+ * index.threads: a boolean ("true" = auto-detect, "false" = single
+ * threaded) or an explicit thread count. Returns 0 for auto.
+ */
+static int config_index_threads(void)
+{
+	const char *str;
+	int threads;
+
+	if (git_config_get_string_const("index.threads", &str))
+		return 0; /* unset: auto-detect */
+
+	threads = git_parse_maybe_bool(str);
+	if (threads == 1)
+		return 0; /* true: auto-detect */
+	if (!threads)
+		return 1; /* false: single threaded */
+
+	if (git_config_get_int("index.threads", &threads))
+		return 0;
+	if (threads < 0)
+		return 0;
+	return threads;
+}
+
 /* remember to discard_cache() before reading a different cache! */
+
 int do_read_index(struct index_state *istate, const char *path, int must_exist)
 {
-	int fd, i;
+	int fd;
 	struct stat st;
 	unsigned long src_offset;
+	int nr_threads, loaded_threaded = 0;
 	struct cache_header *hdr;
 	void *mmap;
 	size_t mmap_size;
@@ -1819,17 +2073,38 @@ int do_read_index(struct index_state *istate, const char *path, int must_exist)
 		previous_name = NULL;
 
 	src_offset = sizeof(*hdr);
-	for (i = 0; i < istate->cache_nr; i++) {
-		struct ondisk_cache_entry *disk_ce;
-		struct cache_entry *ce;
-		unsigned long consumed;
 
-		disk_ce = (struct ondisk_cache_entry *)((char *)mmap + src_offset);
-		ce = create_from_disk(disk_ce, &consumed, previous_name);
-		set_index_entry(istate, i, ce);
+	nr_threads = config_index_threads();
+	if (!nr_threads)
+		nr_threads = online_cpus();
+#ifdef NO_PTHREADS
+	nr_threads = 1;
+#endif
 
-		src_offset += consumed;
+#ifndef NO_PTHREADS
+	if (nr_threads > 1) {
+		struct index_entry_offset_table *ieot;
+		size_t extension_offset;
+
+		extension_offset = read_eoie_extension(mmap, mmap_size);
+		ieot = extension_offset ?
+			read_ieot_extension(mmap, mmap_size, extension_offset) :
+			NULL;
+		if (ieot) {
+			src_offset += load_cache_entries_threaded(istate, mmap,
+								  nr_threads,
+								  ieot);
+			free(ieot);
+			loaded_threaded = 1;
+		}
 	}
+#endif
+
+	if (!loaded_threaded)
+		src_offset += load_cache_entry_block(istate, 0,
+						     istate->cache_nr, mmap,
+						     src_offset,
+						     previous_name);
 	strbuf_release(&previous_name_buf);
 	istate->timestamp.sec = st.st_mtime;
 	istate->timestamp.nsec = ST_MTIME_NSEC(st);
@@ -1853,6 +2128,14 @@ int do_read_index(struct index_state *istate, const char *path, int must_exist)
 		src_offset += extsize;
 	}
 	munmap(mmap, mmap_size);
+
+	/*
+	 * Callers of read_index() do not yet expect sparse directory
+	 * entries, so expand the index to one entry per contained
+	 * file before anybody looks at it.
+	 */
+	ensure_full_index(istate);
+
 	return istate->cache_nr;
 
 unmap:
@@ -1975,8 +2258,11 @@ static int ce_write_flush(git_hash_ctx *context, int fd)
 	return 0;
 }
 
+static uint64_t ce_write_offset;
+
 static int ce_write(git_hash_ctx *context, int fd, void *data, unsigned int len)
 {
+	ce_write_offset += len;
 	while (len) {
 		unsigned int buffered = write_buffer_len;
 		unsigned int partial = WRITE_BUFFER_SIZE - buffered;
@@ -2253,6 +2539,10 @@ static int do_write_index(struct index_state *istate, struct tempfile *tempfile,
 	struct ondisk_cache_entry_extended ondisk;
 	struct strbuf previous_name_buf = STRBUF_INIT, *previous_name;
 	int drop_cache_tree = istate->drop_cache_tree;
+	struct index_entry_offset_table *ieot = NULL;
+	int ieot_entries = 1;
+	uint64_t offset = 0, extension_offset = 0;
+	int nr = 0, wrote_ieot = 0;
 
 	for (i = removed = extended = 0; i < entries; i++) {
 		if (cache[i]->ce_flags & CE_REMOVE)
@@ -2283,11 +2573,32 @@ static int do_write_index(struct index_state *istate, struct tempfile *tempfile,
 	hdr.hdr_entries = htonl(entries - removed);
 
 	the_hash_algo->init_fn(&c);
+	ce_write_offset = 0;
 	if (ce_write(&c, newfd, &hdr, sizeof(hdr)) < 0)
 		return -1;
 
 	previous_name = (hdr_version == 4) ? &previous_name_buf : NULL;
 
+	/*
+	 * Index v4 prefix-compresses each entry name against the
+	 * previous one, so its entries cannot be decoded mid-stream;
+	 * only write the offset table for the fixed-record formats.
+	 */
+	if (!strip_extensions && hdr_version != 4 &&
+	    (entries - removed) >= 2 * 1000) {
+		int blocks = config_index_threads();
+
+		if (!blocks)
+			blocks = online_cpus();
+
+		if (blocks > 1) {
+			ieot_entries = DIV_ROUND_UP(entries - removed, blocks);
+			ieot = xcalloc(1, sizeof(struct index_entry_offset_table)
+				       + blocks * sizeof(struct index_entry_offset));
+		}
+	}
+	offset = ce_write_offset;
+
 	for (i = 0; i < entries; i++) {
 		struct cache_entry *ce = cache[i];
 		if (ce->ce_flags & CE_REMOVE)
@@ -2307,18 +2618,64 @@ static int do_write_index(struct index_state *istate, struct tempfile *tempfile,
 
 			drop_cache_tree = 1;
 		}
+		if (ieot && i && (nr % ieot_entries == 0)) {
+			ieot->entries[ieot->nr].nr = nr;
+			ieot->entries[ieot->nr].offset = offset;
+			ieot->nr++;
+			nr = 0;
+			offset = ce_write_offset;
+		}
 		if (ce_write_entry(&c, newfd, ce, previous_name, (struct ondisk_cache_entry *)&ondisk) < 0)
 			err = -1;
+		nr++;
 
 		if (err)
 			break;
 	}
+	if (ieot && nr) {
+		ieot->entries[ieot->nr].nr = nr;
+		ieot->entries[ieot->nr].offset = offset;
+		ieot->nr++;
+	}
 	strbuf_release(&previous_name_buf);
 
 	if (err)
 		return err;
 
 	/* Write extension data here */
+	extension_offset = ce_write_offset;
+
+	if (ieot) {
+		struct strbuf sb = STRBUF_INIT;
+		int j;
+
+		uint32_t ieot_version = htonl(IEOT_VERSION);
+
+		strbuf_add(&sb, &ieot_version, sizeof(uint32_t));
+		for (j = 0; j < ieot->nr; j++) {
+			uint32_t buffer;
+
+			buffer = htonl(ieot->entries[j].offset);
+			strbuf_add(&sb, &buffer, sizeof(uint32_t));
+			buffer = htonl(ieot->entries[j].nr);
+			strbuf_add(&sb, &buffer, sizeof(uint32_t));
+		}
+		err = write_index_ext_header(&c, newfd,
+					     CACHE_EXT_INDEXENTRYOFFSETTABLE,
+					     sb.len) < 0
+			|| ce_write(&c, newfd, sb.buf, sb.len) < 0;
+		strbuf_release(&sb);
+		FREE_AND_NULL(ieot);
+		wrote_ieot = 1;
+		if (err)
+			return -1;
+	}
+
+	if (!strip_extensions && istate->sparse_index) {
+		if (write_index_ext_header(&c, newfd,
+					   CACHE_EXT_SPARSE_DIRECTORIES, 0) < 0)
+			return -1;
+	}
 	if (!strip_extensions && istate->split_index) {
 		struct strbuf sb = STRBUF_INIT;
 
@@ -2373,6 +2730,29 @@ static int do_write_index(struct index_state *istate, struct tempfile *tempfile,
 			return -1;
 	}
 
+	/*
+	 * The end-of-index-entries extension must come last so readers
+	 * can find it by seeking from EOF; it records where the
+	 * extension area begins so that the offset table can be
+	 * located without parsing all entries. The trailing bytes are
+	 * reserved.
+	 */
+	if (wrote_ieot) {
+		struct strbuf sb = STRBUF_INIT;
+		uint32_t buffer = htonl(extension_offset);
+		unsigned char reserved[GIT_SHA1_RAWSZ] = { 0 };
+
+		strbuf_add(&sb, &buffer, sizeof(uint32_t));
+		strbuf_add(&sb, reserved, sizeof(reserved));
+		err = write_index_ext_header(&c, newfd,
+					     CACHE_EXT_ENDOFINDEXENTRIES,
+					     sb.len) < 0
+			|| ce_write(&c, newfd, sb.buf, sb.len) < 0;
+		strbuf_release(&sb);
+		if (err)
+			return -1;
+	}
+
 	if (ce_flush(&c, newfd, istate->sha1))
 		return -1;
 	if (close_tempfile_gently(tempfile)) {
@@ -2403,7 +2783,14 @@ static int commit_locked_index(struct lock_file *lk)
 static int do_write_locked_index(struct index_state *istate, struct lock_file *lock,
 				 unsigned flags)
 {
-	int ret = do_write_index(istate, lock->tempfile, 0);
+	int ret;
+	struct cache_entry **full_cache = istate->cache;
+	unsigned int full_nr = istate->cache_nr;
+	int converted = convert_to_sparse(istate);
+
+	ret = do_write_index(istate, lock->tempfile, 0);
+	if (converted)
+		restore_full_index(istate, full_cache, full_nr);
 	if (ret)
 		return ret;
 	if (flags & COMMIT_LOCK)
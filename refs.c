@@ -33,6 +33,21 @@ int ref_storage_backend_exists(const char *name)
 	return find_ref_storage_backend(name) != NULL;
 }
 
+const char *list_ref_storage_backends(void)
+{
+	static struct strbuf buf = STRBUF_INIT;
+	struct ref_storage_be *be;
+
+	if (buf.len)
+		return buf.buf;
+	for (be = refs_backends; be; be = be->next) {
+		if (buf.len)
+			strbuf_addstr(&buf, ", ");
+		strbuf_addstr(&buf, be->name);
+	}
+	return buf.buf;
+}
+
 /*
  * How to handle various characters in refnames:
  * 0: An acceptable character for refs
@@ -1640,12 +1655,14 @@ static struct ref_store *lookup_ref_store_map(struct hashmap *map,
 static struct ref_store *ref_store_init(const char *gitdir,
 					unsigned int flags)
 {
-	const char *be_name = "files";
+	const char *be_name = repository_format_ref_storage ?
+		repository_format_ref_storage : "files";
 	struct ref_storage_be *be = find_ref_storage_backend(be_name);
 	struct ref_store *refs;
 
 	if (!be)
-		die("BUG: reference backend %s is unknown", be_name);
+		die(_("reference backend '%s' is unknown; only these are supported: %s"),
+		    be_name, list_ref_storage_backends());
 
 	refs = be->init(gitdir, flags);
 	return refs;
@@ -758,6 +758,9 @@ int reflog_expire(const char *refname, const struct object_id *oid,
 
 int ref_storage_backend_exists(const char *name);
 
+/* Comma-separated list of compiled-in ref storage backend names. */
+const char *list_ref_storage_backends(void);
+
 struct ref_store *get_main_ref_store(void);
 /*
  * Return the ref_store instance for the specified submodule. For the
@@ -19,8 +19,10 @@
 #define SYMMETRIC_LEFT	(1u<<8)
 #define PATCHSAME	(1u<<9)
 #define BOTTOM		(1u<<10)
+#define TOPO_WALK_EXPLORED	(1u<<23)
+#define TOPO_WALK_INDEGREE	(1u<<24)
 #define TRACK_LINEAR	(1u<<26)
-#define ALL_REV_FLAGS	(((1u<<11)-1) | TRACK_LINEAR)
+#define ALL_REV_FLAGS	(((1u<<11)-1) | TOPO_WALK_EXPLORED | TOPO_WALK_INDEGREE | TRACK_LINEAR)
 
 #define DECORATE_SHORT_REFS	1
 #define DECORATE_FULL_REFS	2
@@ -224,6 +226,17 @@ struct rev_info {
 
 	struct commit_list *previous_parents;
 	const char *break_bar;
+
+	/*
+	 * Changed-path Bloom filter support: when the walk is limited
+	 * to a single literal pathspec and the commit graph carries
+	 * filters, rev_compare_tree() can skip the tree diff for
+	 * commits whose filter proves the path unchanged.
+	 */
+	struct bloom_key *bloom_key;
+	struct bloom_filter_settings *bloom_filter_settings;
+
+	struct topo_walk_info *topo_walk_info;
 };
 
 extern int ref_excluded(struct string_list *, const char *path);
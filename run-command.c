@@ -1252,6 +1252,17 @@ int finish_async(struct async *async)
 const char *find_hook(const char *name)
 {
 	static struct strbuf path = STRBUF_INIT;
+	static struct string_list hook_exists_cache = STRING_LIST_INIT_DUP;
+	struct string_list_item *cached;
+
+	/*
+	 * Loops like receive-pack's per-ref updates probe the same
+	 * hooks over and over; the existence verdict cannot change
+	 * within one command, so answer repeats from memory.
+	 */
+	cached = string_list_lookup(&hook_exists_cache, name);
+	if (cached)
+		return cached->util;
 
 	strbuf_reset(&path);
 	strbuf_git_path(&path, "hooks/%s", name);
@@ -1260,8 +1271,11 @@ const char *find_hook(const char *name)
 
 #ifdef STRIP_EXTENSION
 		strbuf_addstr(&path, STRIP_EXTENSION);
-		if (access(path.buf, X_OK) >= 0)
+		if (access(path.buf, X_OK) >= 0) {
+			string_list_insert(&hook_exists_cache, name)->util =
+				xstrdup(path.buf);
 			return path.buf;
+		}
 		if (errno == EACCES)
 			err = errno;
 #endif
@@ -1278,8 +1292,11 @@ const char *find_hook(const char *name)
 				       path.buf);
 			}
 		}
+		string_list_insert(&hook_exists_cache, name)->util = NULL;
 		return NULL;
 	}
+	string_list_insert(&hook_exists_cache, name)->util =
+		xstrdup(path.buf);
 	return path.buf;
 }
 
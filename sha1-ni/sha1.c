@@ -0,0 +1,311 @@
+/*
+ * SHA-1 rounds implemented with the x86 SHA extensions.
+ *
+ * The round computation follows the flow published by Intel for the
+ * sha1rnds4/sha1nexte/sha1msg1/sha1msg2 instructions. CPU support is
+ * detected once at runtime; processors without the extensions use the
+ * portable block-sha1 code instead.
+ */
+#include "../git-compat-util.h"
+#include "sha1.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define HAVE_SHA_NI_BUILD 1
+#include <immintrin.h>
+#include <cpuid.h>
+#endif
+
+#ifdef HAVE_SHA_NI_BUILD
+
+static int sha_ni_available(void)
+{
+	static int available = -1;
+
+	if (available < 0) {
+		unsigned int eax, ebx, ecx, edx;
+
+		available = __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) &&
+			    (ebx & (1 << 29)) && /* SHA */
+			    __get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+			    (ecx & (1 << 19)); /* SSE4.1 */
+	}
+	return available;
+}
+
+__attribute__((target("sha,sse4.1,ssse3")))
+static void ni_SHA1_Block(unsigned int *state, const unsigned char *data,
+			  size_t nblk)
+{
+	const __m128i MASK = _mm_set_epi64x(0x0001020304050607ULL,
+					    0x08090a0b0c0d0e0fULL);
+	__m128i ABCD = _mm_loadu_si128((const __m128i *)state);
+	__m128i E0 = _mm_set_epi32(state[4], 0, 0, 0);
+	__m128i ABCD_SAVE, E0_SAVE, E1;
+	__m128i MSG0, MSG1, MSG2, MSG3;
+
+	ABCD = _mm_shuffle_epi32(ABCD, 0x1B);
+
+	while (nblk--) {
+		ABCD_SAVE = ABCD;
+		E0_SAVE = E0;
+
+		/* Rounds 0-3 */
+		MSG0 = _mm_loadu_si128((const __m128i *)(data + 0));
+		MSG0 = _mm_shuffle_epi8(MSG0, MASK);
+		E0 = _mm_add_epi32(E0, MSG0);
+		E1 = ABCD;
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+
+		/* Rounds 4-7 */
+		MSG1 = _mm_loadu_si128((const __m128i *)(data + 16));
+		MSG1 = _mm_shuffle_epi8(MSG1, MASK);
+		E1 = _mm_sha1nexte_epu32(E1, MSG1);
+		E0 = ABCD;
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 0);
+		MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+
+		/* Rounds 8-11 */
+		MSG2 = _mm_loadu_si128((const __m128i *)(data + 32));
+		MSG2 = _mm_shuffle_epi8(MSG2, MASK);
+		E0 = _mm_sha1nexte_epu32(E0, MSG2);
+		E1 = ABCD;
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+		MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+		MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+		/* Rounds 12-15 */
+		MSG3 = _mm_loadu_si128((const __m128i *)(data + 48));
+		MSG3 = _mm_shuffle_epi8(MSG3, MASK);
+		E1 = _mm_sha1nexte_epu32(E1, MSG3);
+		E0 = ABCD;
+		MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 0);
+		MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+		MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+		/* Rounds 16-19 */
+		E0 = _mm_sha1nexte_epu32(E0, MSG0);
+		E1 = ABCD;
+		MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+		MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+		MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+		/* Rounds 20-23 */
+		E1 = _mm_sha1nexte_epu32(E1, MSG1);
+		E0 = ABCD;
+		MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+		MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+		MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+		/* Rounds 24-27 */
+		E0 = _mm_sha1nexte_epu32(E0, MSG2);
+		E1 = ABCD;
+		MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 1);
+		MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+		MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+		/* Rounds 28-31 */
+		E1 = _mm_sha1nexte_epu32(E1, MSG3);
+		E0 = ABCD;
+		MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+		MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+		MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+		/* Rounds 32-35 */
+		E0 = _mm_sha1nexte_epu32(E0, MSG0);
+		E1 = ABCD;
+		MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 1);
+		MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+		MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+		/* Rounds 36-39 */
+		E1 = _mm_sha1nexte_epu32(E1, MSG1);
+		E0 = ABCD;
+		MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+		MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+		MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+		/* Rounds 40-43 */
+		E0 = _mm_sha1nexte_epu32(E0, MSG2);
+		E1 = ABCD;
+		MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+		MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+		MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+		/* Rounds 44-47 */
+		E1 = _mm_sha1nexte_epu32(E1, MSG3);
+		E0 = ABCD;
+		MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 2);
+		MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+		MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+		/* Rounds 48-51 */
+		E0 = _mm_sha1nexte_epu32(E0, MSG0);
+		E1 = ABCD;
+		MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+		MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+		MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+		/* Rounds 52-55 */
+		E1 = _mm_sha1nexte_epu32(E1, MSG1);
+		E0 = ABCD;
+		MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 2);
+		MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+		MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+		/* Rounds 56-59 */
+		E0 = _mm_sha1nexte_epu32(E0, MSG2);
+		E1 = ABCD;
+		MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+		MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+		MSG0 = _mm_xor_si128(MSG0, MSG2);
+
+		/* Rounds 60-63 */
+		E1 = _mm_sha1nexte_epu32(E1, MSG3);
+		E0 = ABCD;
+		MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+		MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+		MSG1 = _mm_xor_si128(MSG1, MSG3);
+
+		/* Rounds 64-67 */
+		E0 = _mm_sha1nexte_epu32(E0, MSG0);
+		E1 = ABCD;
+		MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 3);
+		MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+		MSG2 = _mm_xor_si128(MSG2, MSG0);
+
+		/* Rounds 68-71 */
+		E1 = _mm_sha1nexte_epu32(E1, MSG1);
+		E0 = ABCD;
+		MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+		MSG3 = _mm_xor_si128(MSG3, MSG1);
+
+		/* Rounds 72-75 */
+		E0 = _mm_sha1nexte_epu32(E0, MSG2);
+		E1 = ABCD;
+		MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 3);
+
+		/* Rounds 76-79 */
+		E1 = _mm_sha1nexte_epu32(E1, MSG3);
+		E0 = ABCD;
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+
+		/* Combine state */
+		E0 = _mm_sha1nexte_epu32(E0, E0_SAVE);
+		ABCD = _mm_add_epi32(ABCD, ABCD_SAVE);
+
+		data += 64;
+	}
+
+	ABCD = _mm_shuffle_epi32(ABCD, 0x1B);
+	_mm_storeu_si128((__m128i *)state, ABCD);
+	state[4] = _mm_extract_epi32(E0, 3);
+}
+
+void ni_SHA1_Init(ni_SHA_CTX *ctx)
+{
+	blk_SHA1_Init(ctx);
+}
+
+void ni_SHA1_Update(ni_SHA_CTX *ctx, const void *data, unsigned long len)
+{
+	unsigned int lenW;
+	const unsigned char *dataIn = data;
+
+	if (!sha_ni_available()) {
+		blk_SHA1_Update(ctx, data, len);
+		return;
+	}
+
+	lenW = ctx->size & 63;
+	ctx->size += len;
+
+	/* Read the data into W and process blocks as they get full */
+	if (lenW) {
+		unsigned int left = 64 - lenW;
+
+		if (len < left)
+			left = len;
+		memcpy(lenW + (char *)ctx->W, dataIn, left);
+		lenW = (lenW + left) & 63;
+		len -= left;
+		dataIn += left;
+		if (lenW)
+			return;
+		ni_SHA1_Block(ctx->H, (const unsigned char *)ctx->W, 1);
+	}
+	if (len >= 64) {
+		ni_SHA1_Block(ctx->H, dataIn, len / 64);
+		dataIn += len & ~(unsigned long)63;
+		len &= 63;
+	}
+	if (len)
+		memcpy(ctx->W, dataIn, len);
+}
+
+void ni_SHA1_Final(unsigned char hashout[20], ni_SHA_CTX *ctx)
+{
+	static const unsigned char pad[64] = { 0x80 };
+	unsigned char padlen[8];
+	unsigned int i;
+
+	if (!sha_ni_available()) {
+		blk_SHA1_Final(hashout, ctx);
+		return;
+	}
+
+	/* Pad with a binary 1 (ie 0x80), then zeroes, then length */
+	padlen[0] = (ctx->size >> 53) & 0xff;
+	padlen[1] = (ctx->size >> 45) & 0xff;
+	padlen[2] = (ctx->size >> 37) & 0xff;
+	padlen[3] = (ctx->size >> 29) & 0xff;
+	padlen[4] = (ctx->size >> 21) & 0xff;
+	padlen[5] = (ctx->size >> 13) & 0xff;
+	padlen[6] = (ctx->size >> 5) & 0xff;
+	padlen[7] = (ctx->size << 3) & 0xff;
+
+	i = ctx->size & 63;
+	ni_SHA1_Update(ctx, pad, 1 + (63 & (55 - i)));
+	ni_SHA1_Update(ctx, padlen, 8);
+
+	for (i = 0; i < 5; i++) {
+		hashout[i * 4 + 0] = ctx->H[i] >> 24;
+		hashout[i * 4 + 1] = ctx->H[i] >> 16;
+		hashout[i * 4 + 2] = ctx->H[i] >> 8;
+		hashout[i * 4 + 3] = ctx->H[i];
+	}
+}
+
+#else /* !HAVE_SHA_NI_BUILD */
+
+void ni_SHA1_Init(ni_SHA_CTX *ctx)
+{
+	blk_SHA1_Init(ctx);
+}
+
+void ni_SHA1_Update(ni_SHA_CTX *ctx, const void *data, unsigned long len)
+{
+	blk_SHA1_Update(ctx, data, len);
+}
+
+void ni_SHA1_Final(unsigned char hashout[20], ni_SHA_CTX *ctx)
+{
+	blk_SHA1_Final(hashout, ctx);
+}
+
+#endif
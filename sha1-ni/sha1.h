@@ -0,0 +1,24 @@
+/*
+ * SHA-1 using the x86 SHA extensions (SHA-NI), with a runtime
+ * fallback to the portable block-sha1 implementation on CPUs that
+ * lack the instructions.
+ */
+
+#include "../block-sha1/sha1.h"
+
+/* block-sha1/sha1.h already defined these for its own use */
+#undef platform_SHA_CTX
+#undef platform_SHA1_Init
+#undef platform_SHA1_Update
+#undef platform_SHA1_Final
+
+typedef blk_SHA_CTX ni_SHA_CTX;
+
+void ni_SHA1_Init(ni_SHA_CTX *ctx);
+void ni_SHA1_Update(ni_SHA_CTX *ctx, const void *dataIn, unsigned long len);
+void ni_SHA1_Final(unsigned char hashout[20], ni_SHA_CTX *ctx);
+
+#define platform_SHA_CTX	ni_SHA_CTX
+#define platform_SHA1_Init	ni_SHA1_Init
+#define platform_SHA1_Update	ni_SHA1_Update
+#define platform_SHA1_Final	ni_SHA1_Final
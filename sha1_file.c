@@ -1150,6 +1150,49 @@ int parse_sha1_header(const char *hdr, unsigned long *sizep)
 	return parse_sha1_header_extended(hdr, &oi, 0);
 }
 
+static int cache_loose_object_oid(const struct object_id *oid,
+				  const char *path,
+				  void *data)
+{
+	oid_array_append(data, oid);
+	return 0;
+}
+
+/*
+ * Check for the existence of a loose object using (and priming) the
+ * per-subdirectory readdir caches, avoiding a stat call per probe.
+ * The caches are never invalidated, so this is only for callers that
+ * can tolerate a racy answer (OBJECT_INFO_QUICK).
+ */
+static int quick_has_loose(struct repository *r, const unsigned char *sha1)
+{
+	int subdir_nr = sha1[0];
+	struct alternate_object_database *alt;
+	static struct alternate_object_database *fakeent;
+	struct object_id oid;
+
+	hashcpy(oid.hash, sha1);
+
+	if (!fakeent)
+		fakeent = alloc_alt_odb(r->objects->objectdir);
+	prepare_alt_odb(r);
+	fakeent->next = r->objects->alt_odb_list;
+
+	for (alt = fakeent; alt; alt = alt->next) {
+		if (!alt->loose_objects_subdir_seen[subdir_nr]) {
+			struct strbuf *buf = alt_scratch_buf(alt);
+			for_each_file_in_obj_subdir(subdir_nr, buf,
+						    cache_loose_object_oid,
+						    NULL, NULL,
+						    &alt->loose_objects_cache);
+			alt->loose_objects_subdir_seen[subdir_nr] = 1;
+		}
+		if (oid_array_lookup(&alt->loose_objects_cache, &oid) >= 0)
+			return 1;
+	}
+	return 0;
+}
+
 static int sha1_loose_object_info(struct repository *r,
 				  const unsigned char *sha1,
 				  struct object_info *oi, int flags)
@@ -1176,6 +1219,14 @@ static int sha1_loose_object_info(struct repository *r,
 	if (!oi->typep && !oi->type_name && !oi->sizep && !oi->contentp) {
 		const char *path;
 		struct stat st;
+		/*
+		 * The readdir caches hang off the_repository's object
+		 * stores; don't answer for other repositories from them.
+		 */
+		if (!oi->disk_sizep &&
+		    (flags & OBJECT_INFO_QUICK_LOOSE_CACHE) &&
+		    r == the_repository)
+			return quick_has_loose(r, sha1) ? 0 : -1;
 		if (stat_sha1_file(r, sha1, &st, &path) < 0)
 			return -1;
 		if (oi->disk_sizep)
@@ -1927,6 +1978,17 @@ int index_fd(struct object_id *oid, int fd, struct stat *st,
 		ret = index_stream_convert_blob(oid, fd, path, flags);
 	else if (!S_ISREG(st->st_mode))
 		ret = index_pipe(oid, fd, type, path, flags);
+	else if (type == OBJ_BLOB && (flags & HASH_WRITE_OBJECT) &&
+		 bulk_checkin_threshold && bulk_checkin_plugged() &&
+		 xsize_t(st->st_size) <= bulk_checkin_threshold &&
+		 !(path && would_convert_to_git(&the_index, path)))
+		/*
+		 * Accumulate small new blobs into the bulk-checkin
+		 * pack instead of creating one loose object (and one
+		 * fsync) apiece.
+		 */
+		ret = index_stream(oid, fd, xsize_t(st->st_size), type, path,
+				   flags);
 	else if (st->st_size <= big_file_threshold || type != OBJ_BLOB ||
 		 (path && would_convert_to_git(&the_index, path)))
 		ret = index_core(oid, fd, xsize_t(st->st_size), type, path,
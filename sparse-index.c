@@ -0,0 +1,223 @@
+#include "cache.h"
+#include "config.h"
+#include "cache-tree.h"
+#include "pathspec.h"
+#include "tree.h"
+#include "sparse-index.h"
+
+struct sparse_convert {
+	struct index_state *istate;
+	struct cache_entry **cache;
+	unsigned int nr, alloc;
+};
+
+static int range_is_skip_worktree(struct index_state *istate,
+				  unsigned int start, unsigned int end)
+{
+	unsigned int i;
+
+	for (i = start; i < end; i++) {
+		struct cache_entry *ce = istate->cache[i];
+
+		if (!ce_skip_worktree(ce))
+			return 0;
+		/*
+		 * Unmerged and intent-to-add entries carry state that a
+		 * plain tree entry cannot represent; keep their
+		 * directories expanded.
+		 */
+		if (ce_stage(ce) || (ce->ce_flags & CE_INTENT_TO_ADD))
+			return 0;
+	}
+	return 1;
+}
+
+static struct cache_entry *make_sparse_dir_entry(struct strbuf *prefix,
+						 const struct object_id *oid)
+{
+	struct cache_entry *ce = xcalloc(1, cache_entry_size(prefix->len));
+
+	memcpy(ce->name, prefix->buf, prefix->len);
+	ce->ce_namelen = prefix->len;
+	ce->ce_mode = S_IFDIR;
+	ce->ce_flags = create_ce_flags(0) | CE_SKIP_WORKTREE;
+	oidcpy(&ce->oid, oid);
+	return ce;
+}
+
+/*
+ * The entries in [start, end) all share 'prefix' (empty or
+ * slash-terminated). Either collapse the whole range into one sparse
+ * directory entry, or copy the immediate files and recurse into the
+ * subdirectories.
+ */
+static void convert_range(struct sparse_convert *out,
+			  unsigned int start, unsigned int end,
+			  struct strbuf *prefix)
+{
+	struct index_state *istate = out->istate;
+	unsigned int i;
+
+	if (prefix->len &&
+	    range_is_skip_worktree(istate, start, end)) {
+		struct cache_tree *ct;
+
+		strbuf_setlen(prefix, prefix->len - 1);
+		ct = cache_tree_find(istate->cache_tree, prefix->buf);
+		strbuf_addch(prefix, '/');
+
+		if (ct && ct->entry_count >= 0) {
+			ALLOC_GROW(out->cache, out->nr + 1, out->alloc);
+			out->cache[out->nr++] =
+				make_sparse_dir_entry(prefix, &ct->oid);
+			return;
+		}
+	}
+
+	i = start;
+	while (i < end) {
+		struct cache_entry *ce = istate->cache[i];
+		const char *rest = ce->name + prefix->len;
+		const char *slash = strchr(rest, '/');
+		size_t baselen, dirlen;
+		unsigned int j;
+
+		if (!slash) {
+			ALLOC_GROW(out->cache, out->nr + 1, out->alloc);
+			out->cache[out->nr++] = ce;
+			i++;
+			continue;
+		}
+
+		dirlen = slash - ce->name + 1;
+		j = i + 1;
+		while (j < end &&
+		       ce_namelen(istate->cache[j]) > dirlen &&
+		       !memcmp(istate->cache[j]->name, ce->name, dirlen))
+			j++;
+
+		baselen = prefix->len;
+		strbuf_add(prefix, rest, slash - rest + 1);
+		convert_range(out, i, j, prefix);
+		strbuf_setlen(prefix, baselen);
+		i = j;
+	}
+}
+
+int convert_to_sparse(struct index_state *istate)
+{
+	struct sparse_convert out = { istate, NULL, 0, 0 };
+	struct strbuf prefix = STRBUF_INIT;
+	int enabled = 0;
+
+	if (!istate->cache_nr || istate->sparse_index || istate->split_index)
+		return 0;
+	if (!core_apply_sparse_checkout)
+		return 0;
+	if (git_config_get_bool("index.sparse", &enabled) || !enabled)
+		return 0;
+	/*
+	 * Collapsed directories borrow their tree OID from the
+	 * cache-tree, so an invalid cache-tree simply means fewer (or
+	 * no) directories can be collapsed.
+	 */
+	if (!istate->cache_tree)
+		return 0;
+
+	convert_range(&out, 0, istate->cache_nr, &prefix);
+	strbuf_release(&prefix);
+
+	if (out.nr == istate->cache_nr) {
+		/* nothing was collapsed */
+		free(out.cache);
+		return 0;
+	}
+
+	istate->cache = out.cache;
+	istate->cache_nr = out.nr;
+	istate->cache_alloc = out.alloc;
+	istate->sparse_index = 1;
+	return 1;
+}
+
+void restore_full_index(struct index_state *istate,
+			struct cache_entry **full_cache,
+			unsigned int full_nr)
+{
+	unsigned int i;
+
+	for (i = 0; i < istate->cache_nr; i++)
+		if (S_ISSPARSEDIR(istate->cache[i]))
+			free(istate->cache[i]);
+	free(istate->cache);
+
+	istate->cache = full_cache;
+	istate->cache_nr = full_nr;
+	istate->cache_alloc = full_nr;
+	istate->sparse_index = 0;
+}
+
+static int add_path_to_full_index(const struct object_id *oid,
+				  struct strbuf *base, const char *path,
+				  unsigned int mode, int stage, void *context)
+{
+	struct sparse_convert *out = context;
+	size_t len;
+	struct cache_entry *ce;
+
+	if (S_ISDIR(mode))
+		return READ_TREE_RECURSIVE;
+
+	len = base->len + strlen(path);
+	ce = xcalloc(1, cache_entry_size(len));
+	memcpy(ce->name, base->buf, base->len);
+	memcpy(ce->name + base->len, path, len - base->len);
+	ce->ce_namelen = len;
+	ce->ce_mode = create_ce_mode(mode);
+	ce->ce_flags = create_ce_flags(stage) | CE_SKIP_WORKTREE;
+	oidcpy(&ce->oid, oid);
+
+	ALLOC_GROW(out->cache, out->nr + 1, out->alloc);
+	out->cache[out->nr++] = ce;
+	return 0;
+}
+
+void ensure_full_index(struct index_state *istate)
+{
+	struct sparse_convert out = { istate, NULL, 0, 0 };
+	struct pathspec ps;
+	unsigned int i;
+
+	if (!istate || !istate->sparse_index)
+		return;
+
+	memset(&ps, 0, sizeof(ps));
+
+	for (i = 0; i < istate->cache_nr; i++) {
+		struct cache_entry *ce = istate->cache[i];
+		struct tree *tree;
+
+		if (!S_ISSPARSEDIR(ce)) {
+			ALLOC_GROW(out.cache, out.nr + 1, out.alloc);
+			out.cache[out.nr++] = ce;
+			continue;
+		}
+
+		tree = lookup_tree(&ce->oid);
+		if (!tree || parse_tree(tree))
+			die(_("unable to read tree %s for sparse directory '%s'"),
+			    oid_to_hex(&ce->oid), ce->name);
+		read_tree_recursive(tree, ce->name, ce_namelen(ce), 0, &ps,
+				    add_path_to_full_index, &out);
+		free(ce);
+	}
+
+	free(istate->cache);
+	istate->cache = out.cache;
+	istate->cache_nr = out.nr;
+	istate->cache_alloc = out.alloc;
+	istate->sparse_index = 0;
+
+	/* the name hash describes the old entry layout */
+	free_name_hash(istate);
+}
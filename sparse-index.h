@@ -0,0 +1,34 @@
+#ifndef SPARSE_INDEX_H
+#define SPARSE_INDEX_H
+
+struct index_state;
+struct cache_entry;
+
+/*
+ * Collapse every directory that lies entirely outside the
+ * sparse-checkout definition (i.e. all of its entries carry
+ * CE_SKIP_WORKTREE and its cache-tree is valid) into a single
+ * sparse directory entry. Replaces istate->cache with a new
+ * array; the caller keeps the old array to restore afterwards.
+ *
+ * Returns 1 if the index was converted, 0 otherwise.
+ */
+int convert_to_sparse(struct index_state *istate);
+
+/*
+ * Undo convert_to_sparse(): free the sparse directory entries and
+ * the collapsed array, and put back the full array saved by the
+ * caller.
+ */
+void restore_full_index(struct index_state *istate,
+			struct cache_entry **full_cache,
+			unsigned int full_nr);
+
+/*
+ * Expand any sparse directory entries back into one cache entry
+ * per contained file by reading the named tree objects. In-core
+ * consumers always see a full index.
+ */
+void ensure_full_index(struct index_state *istate);
+
+#endif
@@ -0,0 +1,61 @@
+#!/bin/sh
+
+test_description='sparse directory entries in the index'
+. ./test-lib.sh
+
+test_expect_success 'setup repo with sparse checkout' '
+	mkdir -p in/deep out1/sub out2 &&
+	for d in in/deep out1/sub out2
+	do
+		for i in 1 2 3
+		do
+			echo "$d $i" >$d/f$i || return 1
+		done
+	done &&
+	git add -A &&
+	git commit -m base &&
+	git config core.sparseCheckout true &&
+	git config index.sparse true &&
+	mkdir -p .git/info &&
+	echo "/in/" >.git/info/sparse-checkout &&
+	git read-tree -mu HEAD
+'
+
+test_expect_success PERL 'excluded directories are collapsed on disk' '
+	ondisk=$(perl -e "open FH, q{<.git/index}; binmode FH; read FH, \$h, 12; print unpack q{N}, substr(\$h, 8, 4)") &&
+	test "$ondisk" -lt 9
+'
+
+test_expect_success 'in-core index is expanded back to full' '
+	git ls-files >actual &&
+	test_line_count = 9 actual &&
+	git ls-files -t | grep "^S " >sparse &&
+	test_line_count = 6 sparse
+'
+
+test_expect_success 'status and commit work with a sparse index' '
+	git status --porcelain -uno >out &&
+	test_must_be_empty out &&
+	echo change >in/deep/f1 &&
+	git add in/deep/f1 &&
+	git commit -m change &&
+	git status --porcelain -uno >out &&
+	test_must_be_empty out
+'
+
+test_expect_success 'collapsed directories survive a commit' '
+	git ls-tree -r HEAD --name-only >actual &&
+	test_line_count = 9 actual &&
+	echo "out1/sub 2" >expect &&
+	git show HEAD:out1/sub/f2 >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'disabling index.sparse writes a full index again' '
+	git config index.sparse false &&
+	git read-tree -mu HEAD &&
+	git ls-files >actual &&
+	test_line_count = 9 actual
+'
+
+test_done
@@ -758,4 +758,22 @@ test_expect_success 'detect corrupt index file in fsck' '
 	grep "bad index file" errors
 '
 
+test_expect_success 'connectivity-only reports dangling objects' '
+	git init connectivity-dangling &&
+	(
+		cd connectivity-dangling &&
+		test_commit one &&
+		git checkout --detach &&
+		echo two >one.t &&
+		git commit -am two &&
+		dangling=$(git rev-parse HEAD) &&
+		git checkout master &&
+		git reflog expire --expire=now --all &&
+		git fsck --connectivity-only >out &&
+		grep "dangling commit $dangling" out &&
+		git fsck --connectivity-only --no-dangling >out &&
+		test_must_be_empty out
+	)
+'
+
 test_done
@@ -0,0 +1,42 @@
+#!/bin/sh
+
+test_description='parallel checkout'
+. ./test-lib.sh
+
+test_expect_success 'setup repo with many files' '
+	mkdir sub &&
+	for i in $(test_seq 1 200)
+	do
+		echo "content $i" >f$i.t &&
+		echo "sub $i" >sub/s$i.t || return 1
+	done &&
+	echo "text=1" >.gitattributes &&
+	test_chmod +x f1.t &&
+	git add -A &&
+	git commit -m files
+'
+
+test_expect_success 'sequential and parallel checkout produce the same tree' '
+	git -c checkout.workers=1 clone --no-local . sequential &&
+	git -c checkout.workers=4 -c checkout.thresholdForParallelism=50 \
+		clone --no-local . parallel &&
+	(cd sequential && git ls-files -s) >expect &&
+	(cd parallel && git ls-files -s) >actual &&
+	test_cmp expect actual &&
+	diff -r sequential parallel -x .git
+'
+
+test_expect_success 'parallel checkout leaves a clean status' '
+	git -C parallel -c checkout.workers=4 status --porcelain >out &&
+	test_must_be_empty out
+'
+
+test_expect_success 'parallel checkout -f restores removed files' '
+	rm -rf parallel/sub &&
+	git -C parallel -c checkout.workers=4 \
+		-c checkout.thresholdForParallelism=50 checkout -f -- . &&
+	git -C parallel status --porcelain >out &&
+	test_must_be_empty out
+'
+
+test_done
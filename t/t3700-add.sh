@@ -403,4 +403,27 @@ test_expect_success 'all statuses changed in folder if . is given' '
 	test $(git ls-files --stage | grep ^100755 | wc -l) -eq 0
 '
 
+test_expect_success 'add of empty file with bulk-checkin disabled stays loose' '
+	git init bulk-empty &&
+	(
+		cd bulk-empty &&
+		>empty &&
+		git add empty &&
+		find .git/objects/pack -type f >packs &&
+		test_must_be_empty packs
+	)
+'
+
+test_expect_success 'bulk-checkin threshold packs small adds' '
+	git init bulk-small &&
+	(
+		cd bulk-small &&
+		git config core.bulkCheckinThreshold 1M &&
+		echo content >small &&
+		git add small &&
+		find .git/objects/pack -type f -name "*.pack" >packs &&
+		test_line_count = 1 packs
+	)
+'
+
 test_done
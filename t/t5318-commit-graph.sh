@@ -0,0 +1,165 @@
+#!/bin/sh
+
+test_description='commit graph'
+. ./test-lib.sh
+
+test_expect_success 'setup full repo' '
+	mkdir full &&
+	cd "$TRASH_DIRECTORY/full" &&
+	git init &&
+	git config core.commitGraph true &&
+	objdir=".git/objects"
+'
+
+test_expect_success 'write graph with no packs' '
+	cd "$TRASH_DIRECTORY/full" &&
+	git commit-graph write --object-dir . &&
+	test_path_is_file info/commit-graph
+'
+
+test_expect_success 'create commits and repack' '
+	cd "$TRASH_DIRECTORY/full" &&
+	for i in $(test_seq 3)
+	do
+		test_commit $i &&
+		git branch commits/$i || return 1
+	done &&
+	git repack
+'
+
+graph_read_expect() {
+	OPTIONAL=""
+	NUM_CHUNKS=3
+	if test ! -z "$2"
+	then
+		OPTIONAL=" $2"
+		NUM_CHUNKS=$((3 + $(echo "$2" | wc -w)))
+	fi
+	cat >expect <<- EOF
+	header: 43475048 1 1 $NUM_CHUNKS 0
+	num_commits: $1
+	chunks: oid_fanout oid_lookup commit_metadata$OPTIONAL
+	EOF
+	git commit-graph read >output &&
+	test_cmp expect output
+}
+
+test_expect_success 'write graph' '
+	cd "$TRASH_DIRECTORY/full" &&
+	graph1=$(git commit-graph write) &&
+	test_path_is_file $objdir/info/commit-graph &&
+	graph_read_expect "3"
+'
+
+test_expect_success 'graph exists and commands succeed' '
+	cd "$TRASH_DIRECTORY/full" &&
+	git log --oneline >expect &&
+	git log --oneline >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'Add more commits' '
+	cd "$TRASH_DIRECTORY/full" &&
+	git reset --hard commits/1 &&
+	for i in $(test_seq 4 5)
+	do
+		test_commit $i &&
+		git branch commits/$i || return 1
+	done &&
+	git reset --hard commits/2 &&
+	for i in $(test_seq 6 7)
+	do
+		test_commit $i &&
+		git branch commits/$i || return 1
+	done &&
+	git reset --hard commits/2 &&
+	git merge commits/4 &&
+	git branch merge/1 &&
+	git reset --hard commits/4 &&
+	git merge commits/6 &&
+	git branch merge/2 &&
+	git reset --hard commits/3 &&
+	git merge commits/5 commits/7 &&
+	git branch merge/3 &&
+	git repack
+'
+
+# Current graph structure:
+#
+#   __M3___
+#  /   |   \
+# 1 __M2__ M1
+# |/  |  \ /|
+# 2   4   6 3
+# |___/____/
+# 5   7
+# |   |
+# 1   2
+#
+# (octopus merge M3 requires the large edges chunk)
+
+test_expect_success 'write graph with merges' '
+	cd "$TRASH_DIRECTORY/full" &&
+	git commit-graph write &&
+	test_path_is_file $objdir/info/commit-graph &&
+	graph_read_expect "10" "large_edges"
+'
+
+compare_results_with_commit_graph() {
+	cd "$TRASH_DIRECTORY/full" &&
+	git -c core.commitGraph=false $1 >expect &&
+	git -c core.commitGraph=true $1 >output &&
+	test_cmp expect output
+}
+
+test_expect_success 'git log is unchanged with commit graph' '
+	compare_results_with_commit_graph "log --oneline --topo-order --all"
+'
+
+test_expect_success 'limited topo-order log is unchanged with commit graph' '
+	compare_results_with_commit_graph "log --oneline --topo-order -n 5 --all"
+'
+
+test_expect_success 'date-order log is unchanged with commit graph' '
+	compare_results_with_commit_graph "log --oneline --date-order --all"
+'
+
+test_expect_success 'git log --graph is unchanged with commit graph' '
+	compare_results_with_commit_graph "log --graph --all"
+'
+
+test_expect_success 'git merge-base is unchanged with commit graph' '
+	compare_results_with_commit_graph "merge-base merge/1 merge/2"
+'
+
+test_expect_success 'git branch --contains is unchanged with commit graph' '
+	compare_results_with_commit_graph "branch --contains commits/1"
+'
+
+test_expect_success 'write graph with changed-path filters' '
+	cd "$TRASH_DIRECTORY/full" &&
+	git commit-graph write --changed-paths &&
+	test_path_is_file $objdir/info/commit-graph &&
+	graph_read_expect "10" "large_edges bloom_indexes bloom_data"
+'
+
+test_expect_success 'git log -- path is unchanged with changed-path filters' '
+	compare_results_with_commit_graph "log --oneline -- 3.t"
+'
+
+test_expect_success 'git log -- unknown path is empty with changed-path filters' '
+	cd "$TRASH_DIRECTORY/full" &&
+	git -c core.commitGraph=true log --oneline -- does-not-exist >output &&
+	test_must_be_empty output
+'
+
+test_expect_success 'perform fast-forward merge in full repo' '
+	cd "$TRASH_DIRECTORY/full" &&
+	git checkout -b merge-1-to-3 commits/1 &&
+	git merge commits/3 &&
+	git show-ref -s merge-1-to-3 >output &&
+	git show-ref -s commits/3 >expect &&
+	test_cmp expect output
+'
+
+test_done
@@ -0,0 +1,46 @@
+#!/bin/sh
+
+test_description='multi-pack-indexes'
+. ./test-lib.sh
+
+test_expect_success 'setup packs' '
+	for i in $(test_seq 1 5)
+	do
+		test_commit $i &&
+		git repack || return 1
+	done &&
+	ls .git/objects/pack/*.idx >idx-list &&
+	test_line_count = 5 idx-list
+'
+
+test_expect_success 'write midx' '
+	git multi-pack-index write &&
+	test_path_is_file .git/objects/pack/multi-pack-index
+'
+
+test_expect_success 'write midx is idempotent' '
+	cp .git/objects/pack/multi-pack-index midx-backup &&
+	git multi-pack-index write &&
+	test_cmp midx-backup .git/objects/pack/multi-pack-index
+'
+
+test_expect_success 'object lookups succeed through midx' '
+	git config core.multiPackIndex true &&
+	git log --oneline >expect.log &&
+	git -c core.multiPackIndex=false log --oneline >actual.log &&
+	test_cmp expect.log actual.log &&
+	git cat-file blob HEAD:1.t >actual &&
+	echo 1 >expect &&
+	test_cmp expect actual &&
+	git fsck
+'
+
+test_expect_success 'midx survives a repack' '
+	git repack -ad &&
+	git multi-pack-index write &&
+	git log --oneline >actual.log &&
+	test_cmp expect.log actual.log &&
+	git fsck
+'
+
+test_done
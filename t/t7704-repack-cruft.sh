@@ -0,0 +1,61 @@
+#!/bin/sh
+
+test_description='repack --cruft'
+. ./test-lib.sh
+
+test_expect_success 'setup reachable and unreachable objects' '
+	test_commit one &&
+	test_commit two &&
+	git checkout --detach HEAD &&
+	echo dropped >dropped.t &&
+	git add dropped.t &&
+	git commit -m dropped &&
+	dropped=$(git rev-parse HEAD) &&
+	git checkout master &&
+	git reflog expire --expire=now --all &&
+	git repack -adq &&
+	find .git/objects/?? -type f >unreachable-loose &&
+	test-tool chmtime =-86400 $(cat unreachable-loose)
+'
+
+test_expect_success '--cruft moves unreachable objects to a cruft pack' '
+	git repack -adq --cruft &&
+	ls .git/objects/pack/*.cruft >cruft-tables &&
+	test_line_count = 1 cruft-tables &&
+	git cat-file -t $dropped >type &&
+	echo commit >expect &&
+	test_cmp expect type &&
+	find .git/objects -mindepth 2 -maxdepth 2 -type f \
+		-path "*/objects/??/*" >loose &&
+	test_must_be_empty loose
+'
+
+test_expect_success 'recorded mtimes survive another cruft repack' '
+	grep $dropped .git/objects/pack/*.cruft >before &&
+	git repack -adq --cruft &&
+	grep $dropped .git/objects/pack/*.cruft >after &&
+	test_cmp before after
+'
+
+test_expect_success '--cruft-expiration drops old cruft' '
+	git repack -adq --cruft --cruft-expiration=12.hours.ago &&
+	test_must_fail git cat-file -e $dropped &&
+	test $(find .git/objects/pack -name "*.cruft" | wc -l) = 0
+'
+
+test_expect_success 'split reachable packs are not treated as cruft' '
+	test-tool genrandom one 1200000 >big1 &&
+	test-tool genrandom two 1200000 >big2 &&
+	git add big1 big2 &&
+	test_tick &&
+	git commit -m big &&
+	git repack -adq --cruft --max-pack-size=1m &&
+	packs=$(ls .git/objects/pack/*.pack | wc -l) &&
+	test $packs -gt 1 &&
+	git fsck &&
+	git cat-file -e $(git rev-parse HEAD) &&
+	head=$(git rev-parse HEAD) &&
+	! grep -h $head .git/objects/pack/*.cruft
+'
+
+test_done
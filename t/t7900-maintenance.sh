@@ -0,0 +1,43 @@
+#!/bin/sh
+
+test_description='git maintenance builtin'
+. ./test-lib.sh
+
+test_expect_success 'help shows usage for bad verb' '
+	test_commit one &&
+	test_must_fail git maintenance bogus 2>err &&
+	test_i18ngrep "usage" err
+'
+
+test_expect_success 'default run packs loose objects' '
+	test_commit two &&
+	git maintenance run &&
+	find .git/objects -mindepth 2 -maxdepth 2 -type f \
+		-path "*/objects/??/*" >loose &&
+	test_must_be_empty loose
+'
+
+test_expect_success 'unknown task is rejected' '
+	test_must_fail git maintenance run --task=bogus 2>err &&
+	test_i18ngrep "not a valid maintenance task" err
+'
+
+test_expect_success 'gc task succeeds under the maintenance lease' '
+	git maintenance run --task=gc
+'
+
+test_expect_success 'maintenance steps aside for a running collector' '
+	printf "%d %s" $$ "$(hostname 2>/dev/null || echo unknown)" \
+		>.git/gc.pid &&
+	test_when_finished "rm -f .git/gc.pid" &&
+	git maintenance run 2>err &&
+	test_i18ngrep "skipping maintenance" err
+'
+
+test_expect_success 'task selection respects maintenance.<task>.enabled' '
+	git -c maintenance.loose-objects.enabled=false \
+	    -c maintenance.incremental-repack.enabled=false \
+	    maintenance run
+'
+
+test_done
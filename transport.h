@@ -21,6 +21,7 @@ struct git_transport_options {
 	int depth;
 	const char *deepen_since;
 	const struct string_list *deepen_not;
+	const struct string_list *negotiation_tips;
 	const char *uploadpack;
 	const char *receivepack;
 	struct push_cas_option *cas;
@@ -151,6 +152,9 @@ void transport_check_allowed(const char *type);
 /* Limit the depth of the fetch based on revs if not null */
 #define TRANS_OPT_DEEPEN_NOT "deepen-not"
 
+/* Limit commit negotiation to these tips (refs, globs or object names) */
+#define TRANS_OPT_NEGOTIATION_TIP "negotiation-tip"
+
 /* Limit the deepen of the fetch if not null */
 #define TRANS_OPT_DEEPEN_RELATIVE "deepen-relative"
 
@@ -232,8 +232,25 @@ int parse_tree_gently(struct tree *item, int quiet_on_missing)
 	return parse_tree_buffer(item, buffer, size);
 }
 
+/*
+ * Callers release tree buffers to bound walk memory, but dropping
+ * every buffer means hot subtrees get re-inflated from the object
+ * store thousands of times during path-limited walks. Retain small
+ * buffers until a global budget is exhausted; the parsed tree stays
+ * usable and the release degrades to an accounting no-op.
+ */
+#define TREE_BUFFER_RETAIN_LIMIT (16 * 1024 * 1024)
+#define TREE_BUFFER_RETAIN_MAX_SIZE (4 * 1024)
+
+static unsigned long tree_buffers_retained;
+
 void free_tree_buffer(struct tree *tree)
 {
+	if (tree->buffer && tree->size <= TREE_BUFFER_RETAIN_MAX_SIZE &&
+	    tree_buffers_retained + tree->size < TREE_BUFFER_RETAIN_LIMIT) {
+		tree_buffers_retained += tree->size;
+		return;
+	}
 	FREE_AND_NULL(tree->buffer);
 	tree->size = 0;
 	tree->object.parsed = 0;
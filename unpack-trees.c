@@ -15,6 +15,7 @@
 #include "submodule.h"
 #include "submodule-config.h"
 #include "fsmonitor.h"
+#include "parallel-checkout.h"
 #include "fetch-object.h"
 
 /*
@@ -340,6 +341,7 @@ static int check_updates(struct unpack_trees_options *o)
 	struct progress *progress = NULL;
 	struct index_state *index = &o->result;
 	struct checkout state = CHECKOUT_INIT;
+	struct parallel_checkout pc;
 	int i;
 
 	state.force = 1;
@@ -393,6 +395,7 @@ static int check_updates(struct unpack_trees_options *o)
 		fetch_if_missing = fetch_if_missing_store;
 		oid_array_clear(&to_fetch);
 	}
+	init_parallel_checkout(&pc, &state);
 	for (i = 0; i < index->cache_nr; i++) {
 		struct cache_entry *ce = index->cache[i];
 
@@ -400,13 +403,17 @@ static int check_updates(struct unpack_trees_options *o)
 			if (ce->ce_flags & CE_WT_REMOVE)
 				die("BUG: both update and delete flags are set on %s",
 				    ce->name);
-			display_progress(progress, ++cnt);
 			ce->ce_flags &= ~CE_UPDATE;
 			if (o->update && !o->dry_run) {
-				errs |= checkout_entry(ce, &state, NULL);
-			}
+				if (!parallel_checkout_enqueue(&pc, ce)) {
+					display_progress(progress, ++cnt);
+					errs |= checkout_entry(ce, &state, NULL);
+				}
+			} else
+				display_progress(progress, ++cnt);
 		}
 	}
+	errs |= run_parallel_checkout(&pc, progress, &cnt);
 	stop_progress(&progress);
 	errs |= finish_delayed_checkout(&state);
 	if (o->update)
@@ -21,6 +21,8 @@
 #include "argv-array.h"
 #include "prio-queue.h"
 #include "protocol.h"
+#include "pack.h"
+#include "pack-bitmap.h"
 #include "quote.h"
 
 static const char * const upload_pack_usage[] = {
@@ -102,6 +104,52 @@ static int write_one_shallow(const struct commit_graft *graft, void *cb_data)
 	return 0;
 }
 
+/*
+ * Full clones of a big repository produce (nearly) the same pack over
+ * and over. When uploadpack.packCacheDir is set, cache the raw pack
+ * stream of have-less, shallow-less, filter-less requests keyed by
+ * the sorted want set and replay it for identical requests, so the
+ * bulk of clone traffic is served by sendfile-speed reads instead of
+ * re-running pack-objects. Eviction is left to the operator (e.g. a
+ * tmpwatch over the directory).
+ */
+static const char *pack_cache_dir;
+
+static int oid_compare_for_cache(const void *a, const void *b)
+{
+	return oidcmp(a, b);
+}
+
+static char *pack_cache_path(void)
+{
+	struct object_id *oids;
+	git_hash_ctx ctx;
+	unsigned char key[GIT_MAX_RAWSZ];
+	int i;
+	char *path;
+
+	if (!pack_cache_dir || have_obj.nr || shallow_nr ||
+	    filter_options.filter_spec || !want_obj.nr)
+		return NULL;
+
+	ALLOC_ARRAY(oids, want_obj.nr);
+	for (i = 0; i < want_obj.nr; i++)
+		oidcpy(&oids[i], &want_obj.objects[i].item->oid);
+	QSORT(oids, want_obj.nr, oid_compare_for_cache);
+
+	the_hash_algo->init_fn(&ctx);
+	the_hash_algo->update_fn(&ctx, use_ofs_delta ? "o" : "-", 1);
+	the_hash_algo->update_fn(&ctx, use_include_tag ? "t" : "-", 1);
+	for (i = 0; i < want_obj.nr; i++)
+		the_hash_algo->update_fn(&ctx, oids[i].hash,
+					 the_hash_algo->rawsz);
+	the_hash_algo->final_fn(key, &ctx);
+	free(oids);
+
+	path = xstrfmt("%s/pack-%s", pack_cache_dir, sha1_to_hex(key));
+	return path;
+}
+
 static void create_pack_file(void)
 {
 	struct child_process pack_objects = CHILD_PROCESS_INIT;
@@ -112,6 +160,35 @@ static void create_pack_file(void)
 	ssize_t sz;
 	int i;
 	FILE *pipe_fd;
+	char *cache_path = pack_cache_path();
+	int cache_fd = -1;
+	struct strbuf cache_tmp = STRBUF_INIT;
+
+	if (cache_path) {
+		int fd = open(cache_path, O_RDONLY);
+
+		if (fd >= 0) {
+			/* replay the cached pack stream */
+			for (;;) {
+				sz = xread(fd, data, sizeof(data) - 1);
+				if (sz < 0)
+					die_errno("cached pack read error");
+				if (!sz)
+					break;
+				send_client_data(1, data, sz);
+			}
+			close(fd);
+			if (use_sideband)
+				packet_flush(1);
+			free(cache_path);
+			return;
+		}
+		strbuf_addf(&cache_tmp, "%s.%"PRIuMAX, cache_path,
+			    (uintmax_t)getpid());
+		cache_fd = open(cache_tmp.buf, O_WRONLY | O_CREAT | O_EXCL,
+				0666);
+		/* cache_fd < 0 simply means we don't cache this one */
+	}
 
 	if (!pack_objects_hook)
 		pack_objects.git_cmd = 1;
@@ -267,6 +344,12 @@ static void create_pack_file(void)
 			}
 			else
 				buffered = -1;
+			if (0 <= cache_fd &&
+			    write_in_full(cache_fd, data, sz) < 0) {
+				close(cache_fd);
+				cache_fd = -1;
+				unlink(cache_tmp.buf);
+			}
 			send_client_data(1, data, sz);
 		}
 
@@ -294,14 +377,29 @@ static void create_pack_file(void)
 	/* flush the data */
 	if (0 <= buffered) {
 		data[0] = buffered;
+		if (0 <= cache_fd && write_in_full(cache_fd, data, 1) < 0) {
+			close(cache_fd);
+			cache_fd = -1;
+			unlink(cache_tmp.buf);
+		}
 		send_client_data(1, data, 1);
 		fprintf(stderr, "flushed.\n");
 	}
+	if (0 <= cache_fd) {
+		if (close(cache_fd) || rename(cache_tmp.buf, cache_path))
+			unlink(cache_tmp.buf);
+	}
+	free(cache_path);
+	strbuf_release(&cache_tmp);
 	if (use_sideband)
 		packet_flush(1);
 	return;
 
  fail:
+	if (0 <= cache_fd) {
+		close(cache_fd);
+		unlink(cache_tmp.buf);
+	}
 	send_client_data(3, abort_msg, sizeof(abort_msg));
 	die("git upload-pack: %s", abort_msg);
 }
@@ -598,6 +696,25 @@ static int has_unreachable(struct object_array *src)
 	struct child_process cmd = CHILD_PROCESS_INIT;
 	char buf[1];
 	int i;
+	struct object_array our_tips = OBJECT_ARRAY_INIT;
+	struct object *o;
+
+	/*
+	 * If reachability bitmaps cover our ref tips, containment in
+	 * their union answers the question without spawning a
+	 * rev-list. A miss only means "unknown", so fall through to
+	 * the walk in that case.
+	 */
+	for (i = get_max_object_index(); 0 < i; ) {
+		o = get_indexed_object(--i);
+		if (o && is_our_ref(o))
+			add_object_array(o, NULL, &our_tips);
+	}
+	if (bitmaps_prove_reachable(&our_tips, src)) {
+		object_array_clear(&our_tips);
+		return 0;
+	}
+	object_array_clear(&our_tips);
 
 	if (do_reachable_revlist(&cmd, src, NULL) < 0)
 		return 1;
@@ -951,6 +1068,46 @@ static void format_symref_info(struct strbuf *buf, struct string_list *symref)
 		strbuf_addf(buf, " symref=%s:%s", item->string, (char *)item->util);
 }
 
+static struct string_list advertise_ref_prefixes = STRING_LIST_INIT_DUP;
+
+static void parse_protocol_extra_params(void)
+{
+	const char *env = getenv(GIT_PROTOCOL_ENVIRONMENT);
+	struct string_list params = STRING_LIST_INIT_DUP;
+	const struct string_list_item *item;
+
+	if (!env)
+		return;
+
+	string_list_split(&params, env, ':', -1);
+	for_each_string_list_item(item, &params) {
+		const char *value;
+
+		if (skip_prefix(item->string, "ref-prefix=", &value) && *value)
+			string_list_append(&advertise_ref_prefixes, value);
+	}
+	string_list_clear(&params, 0);
+}
+
+/*
+ * When the client supplied ref-prefix patterns, advertise only the
+ * matching refs (HEAD is always advertised). The tips of filtered
+ * refs still carry OUR_REF, so a "want" for them remains valid.
+ */
+static int ref_prefix_excluded(const char *refname_nons)
+{
+	const struct string_list_item *item;
+
+	if (!advertise_ref_prefixes.nr)
+		return 0;
+	if (!strcmp(refname_nons, "HEAD"))
+		return 0;
+	for_each_string_list_item(item, &advertise_ref_prefixes)
+		if (starts_with(refname_nons, item->string))
+			return 0;
+	return 1;
+}
+
 static int send_ref(const char *refname, const struct object_id *oid,
 		    int flag, void *cb_data)
 {
@@ -962,6 +1119,8 @@ static int send_ref(const char *refname, const struct object_id *oid,
 
 	if (mark_our_ref(refname_nons, refname, oid))
 		return 0;
+	if (ref_prefix_excluded(refname_nons))
+		return 0;
 
 	if (capabilities) {
 		struct strbuf symref_info = STRBUF_INIT;
@@ -1008,6 +1167,7 @@ static void upload_pack(void)
 {
 	struct string_list symref = STRING_LIST_INIT_DUP;
 
+	parse_protocol_extra_params();
 	head_ref_namespaced(find_symref, &symref);
 
 	if (advertise_refs || !stateless_rpc) {
@@ -1033,6 +1193,8 @@ static void upload_pack(void)
 
 static int upload_pack_config(const char *var, const char *value, void *unused)
 {
+	if (!strcmp("uploadpack.packcachedir", var))
+		return git_config_pathname(&pack_cache_dir, var, value);
 	if (!strcmp("uploadpack.allowtipsha1inwant", var)) {
 		if (git_config_bool(var, value))
 			allow_unadvertised_object_request |= ALLOW_TIP_SHA1;